@@ -0,0 +1,509 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../src/ruler.hh"
+#include "../src/rulerrenderpool.hh"
+
+////////////////////////////////////////////////////////////////////////
+// Counting the Cairo calls and heap allocations
+
+namespace
+{
+    // The tile benchmark renders on several threads, so the counters are atomic
+    std::atomic<long> strokeCount{};
+    std::atomic<long> lineCount{};
+    std::atomic<long> showTextCount{};
+    std::atomic<long> allocationCount{};
+
+    template <typename F>
+    F realFunction(const char *name)
+    {
+        return reinterpret_cast<F>(dlsym(RTLD_NEXT, name)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    }
+
+    void resetCounters()
+    {
+        strokeCount = 0;
+        lineCount = 0;
+        showTextCount = 0;
+        allocationCount = 0;
+    }
+} // namespace
+
+// The ruler library is linked statically, so its calls resolve to these definitions
+// instead of the ones in libcairo. The calls are counted and passed on to Cairo.
+
+extern "C" void cairo_stroke(cairo_t *cr)
+{
+    static auto *real = realFunction<void (*)(cairo_t *)>("cairo_stroke");
+    strokeCount++;
+    real(cr);
+}
+
+extern "C" void cairo_line_to(cairo_t *cr, double x, double y)
+{
+    static auto *real = realFunction<void (*)(cairo_t *, double, double)>("cairo_line_to");
+    lineCount++;
+    real(cr, x, y);
+}
+
+extern "C" void cairo_show_text(cairo_t *cr, const char *utf8)
+{
+    static auto *real = realFunction<void (*)(cairo_t *, const char *)>("cairo_show_text");
+    showTextCount++;
+    real(cr, utf8);
+}
+
+#ifdef __GLIBC__
+// Every heap allocation in the process, including the ones made by GTK and Cairo,
+// resolves to these definitions. They are counted and passed on to glibc.
+
+extern "C" void *__libc_malloc(size_t size);               // NOLINT(bugprone-reserved-identifier)
+extern "C" void *__libc_calloc(size_t count, size_t size); // NOLINT(bugprone-reserved-identifier)
+extern "C" void *__libc_realloc(void *ptr, size_t size);   // NOLINT(bugprone-reserved-identifier)
+
+extern "C" void *malloc(size_t size)
+{
+    allocationCount++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    allocationCount++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    allocationCount++;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Benchmarks
+
+namespace
+{
+    /** A range for the ruler to display. */
+    struct BenchRange
+    {
+        const char *name;
+        double      lower;
+        double      upper;
+    };
+
+    /** How the range of the ruler changes from frame to frame. */
+    enum Sequence
+    {
+        /** The range stays the same, so frames after the first are drawn from the caches. */
+        STATIC,
+        /** The range is panned by a few pixels every frame. */
+        PAN,
+        /** The range is panned by a few pixels every frame with Ruler::scrollBy(), instead of setting it. */
+        SCROLL,
+        /** The range grows a little every frame, so every frame is rendered from scratch. */
+        ZOOM
+    };
+
+    const std::vector<BenchRange> RANGES{
+      {"tiny", 0, 0.5},
+      {"small", -123, 278},
+      {"large", 0, 1e6},
+      {"huge", -1e12, 1e12},
+    };
+
+    const std::vector<int> SIZES{200, 540, 1920, 3840, 7680, 16384};
+
+    /** The distance in pixels the range is panned by every frame. */
+    const double PAN_PIXELS = 3;
+
+    /** The factor the range grows by every frame. */
+    const double ZOOM_FACTOR = 1.001;
+
+    double nanosecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const char *sequenceName(Sequence sequence)
+    {
+        switch (sequence)
+        {
+        case STATIC:
+            return "static";
+        case PAN:
+            return "pan";
+        case SCROLL:
+            return "scroll";
+        case ZOOM:
+            return "zoom";
+        }
+        return "";
+    }
+} // namespace
+
+/**
+ * Renders a ruler into a Cairo image surface a number of times and prints the cost per frame.
+ * The first frame is rendered before the measurement starts, so the caches are filled.
+ * @param orientation The orientation of the ruler.
+ * @param length The width/height of the ruler in pixels.
+ * @param range The range to start at.
+ * @param sequence How the range changes from frame to frame.
+ * @param frames The number of frames to render.
+ */
+static void benchmarkRender(Ruler::Orientation orientation, int length, const BenchRange &range, Sequence sequence, int frames)
+{
+    const int THICKNESS = 30;
+    const int WIDTH = (orientation == Ruler::HORIZONTAL) ? length : THICKNESS;
+    const int HEIGHT = (orientation == Ruler::HORIZONTAL) ? THICKNESS : length;
+
+    GtkWidget *drawingArea = gtk_drawing_area_new();
+    g_object_ref_sink(drawingArea);
+    gtk_widget_show(drawingArea);
+    Ruler::Ptr ruler = Ruler::create(orientation, drawingArea);
+
+    gint minimum{};
+    gint natural{};
+    gtk_widget_get_preferred_width(drawingArea, &minimum, &natural);
+    gtk_widget_get_preferred_height(drawingArea, &minimum, &natural);
+    GtkAllocation allocation{0, 0, WIDTH, HEIGHT};
+    gtk_widget_size_allocate(drawingArea, &allocation);
+
+    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, WIDTH, HEIGHT);
+    cairo_t *cr = cairo_create(image);
+
+    double lower = range.lower;
+    double upper = range.upper;
+    const double PAN_STEP = PAN_PIXELS * (upper - lower) / length;
+
+    ruler->setRange(lower, upper);
+    gboolean handled = FALSE;
+    g_signal_emit_by_name(drawingArea, "draw", cr, &handled);
+
+    resetCounters();
+    const auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        switch (sequence)
+        {
+        case STATIC:
+            break;
+        case PAN:
+            lower += PAN_STEP;
+            upper += PAN_STEP;
+            break;
+        case SCROLL:
+            ruler->scrollBy(PAN_STEP);
+            break;
+        case ZOOM:
+            upper = lower + ZOOM_FACTOR * (upper - lower);
+            break;
+        }
+        if (sequence != SCROLL) { ruler->setRange(lower, upper); }
+        g_signal_emit_by_name(drawingArea, "draw", cr, &handled);
+    }
+    cairo_surface_flush(image);
+    const double NS_PER_FRAME = nanosecondsSince(start) / frames;
+
+    printf("%-10s %6d px %-5s %-6s %12.0f ns/frame %9.1f allocs/frame %6.1f strokes/frame %8.1f lines/frame %6.1f "
+           "show_text/frame\n",
+           orientation == Ruler::HORIZONTAL ? "horizontal" : "vertical",
+           length,
+           range.name,
+           sequenceName(sequence),
+           NS_PER_FRAME,
+           static_cast<double>(allocationCount) / frames,
+           static_cast<double>(strokeCount) / frames,
+           static_cast<double>(lineCount) / frames,
+           static_cast<double>(showTextCount) / frames);
+
+    cairo_destroy(cr);
+    cairo_surface_destroy(image);
+    ruler.reset();
+    g_object_unref(drawingArea);
+}
+
+/**
+ * Moves the marker of a horizontal ruler a number of times, redrawing only the parts the ruler
+ * invalidates for it, and prints the cost per move. This cost shouldn't depend on the size.
+ * @param length The width of the ruler in pixels.
+ * @param range The range of the ruler.
+ * @param events The number of times to move the marker.
+ */
+static void benchmarkMarker(int length, const BenchRange &range, int events)
+{
+    const int THICKNESS = 30;
+
+    GtkWidget *drawingArea = gtk_drawing_area_new();
+    g_object_ref_sink(drawingArea);
+    gtk_widget_show(drawingArea);
+    Ruler::Ptr ruler = Ruler::create(Ruler::HORIZONTAL, drawingArea);
+
+    gint minimum{};
+    gint natural{};
+    gtk_widget_get_preferred_width(drawingArea, &minimum, &natural);
+    gtk_widget_get_preferred_height(drawingArea, &minimum, &natural);
+    GtkAllocation allocation{0, 0, length, THICKNESS};
+    gtk_widget_size_allocate(drawingArea, &allocation);
+
+    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, length, THICKNESS);
+    cairo_t *cr = cairo_create(image);
+
+    ruler->setRange(range.lower, range.upper);
+    gboolean handled = FALSE;
+    g_signal_emit_by_name(drawingArea, "draw", cr, &handled);
+
+    // The marker sweeps across the ruler. Each move redraws the old and new marker, as GTK would
+    const double SCALE = (range.upper - range.lower) / length;
+    const int MARKER_SPAN = 12;
+    resetCounters();
+    const auto start = std::chrono::steady_clock::now();
+    for (int event = 0; event < events; event++)
+    {
+        const int OLD_PIXEL = (event * 7) % length;
+        const int NEW_PIXEL = ((event + 1) * 7) % length;
+        ruler->setMarkerPosition(range.lower + NEW_PIXEL * SCALE);
+
+        cairo_save(cr);
+        cairo_rectangle(cr, OLD_PIXEL - MARKER_SPAN, 0, 2 * MARKER_SPAN, THICKNESS);
+        cairo_rectangle(cr, NEW_PIXEL - MARKER_SPAN, 0, 2 * MARKER_SPAN, THICKNESS);
+        cairo_clip(cr);
+        g_signal_emit_by_name(drawingArea, "draw", cr, &handled);
+        cairo_restore(cr);
+    }
+    cairo_surface_flush(image);
+    const double NS_PER_EVENT = nanosecondsSince(start) / events;
+
+    printf("%-10s %6d px %-5s %-6s %12.0f ns/move %9.1f allocs/move %6.1f strokes/move\n",
+           "marker",
+           length,
+           range.name,
+           "move",
+           NS_PER_EVENT,
+           static_cast<double>(allocationCount) / events,
+           static_cast<double>(strokeCount) / events);
+
+    cairo_destroy(cr);
+    cairo_surface_destroy(image);
+    ruler.reset();
+    g_object_unref(drawingArea);
+}
+
+/**
+ * Lays out the ticks of a ruler of a given size a number of times, without drawing them,
+ * zooming out a little with every layout, and prints the cost per layout.
+ * @param length The width/height of the ruler in pixels.
+ * @param range The range to start at.
+ * @param iterations The number of layouts to compute.
+ */
+static void benchmarkLayout(int length, const BenchRange &range, int iterations)
+{
+    TickLayout layout;
+    size_t ticks = 0;
+    const double LOWER = range.lower;
+    double upper = range.upper;
+
+    resetCounters();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        upper = LOWER + ZOOM_FACTOR * (upper - LOWER);
+        const double INTERVAL = RulerCalculations::calculateInterval(LOWER, upper, length);
+        const int SPACING = RulerCalculations::intervalPixelSpacing(INTERVAL, LOWER, upper, length);
+        layout.compute(LOWER, upper, length, INTERVAL, SPACING, 24);
+        ticks += layout.getTickCount();
+    }
+    const double NS_PER_LAYOUT = nanosecondsSince(start) / iterations;
+
+    printf("%-10s %6d px %-5s %-6s %12.0f ns/layout %8.1f allocs/layout %8.1f ticks/layout\n",
+           "layout",
+           length,
+           range.name,
+           "zoom",
+           NS_PER_LAYOUT,
+           static_cast<double>(allocationCount) / iterations,
+           static_cast<double>(ticks) / iterations);
+}
+
+/**
+ * Renders batches of rulers into image tiles on a render pool, without GTK, and prints the throughput.
+ * Every tile shows another part of a large range, as when a ruler is burnt into the tiles of an exported image.
+ * The first batch is rendered before the measurement starts, so the caches of the workers are filled.
+ * @param threadCount The number of worker threads of the pool.
+ * @param length The width of the tiles in pixels.
+ * @param batches The number of batches to render.
+ */
+static void benchmarkTiles(unsigned threadCount, int length, int batches)
+{
+    const int THICKNESS = 30;
+    const int TILES_PER_BATCH = 256;
+
+    std::vector<RulerRenderer::Tile> tiles;
+    for (int i = 0; i < TILES_PER_BATCH; i++)
+    {
+        cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, length, THICKNESS);
+        const double LOWER = static_cast<double>(i) * length;
+        tiles.push_back(RulerRenderer::Tile{surface, RulerRenderer::HORIZONTAL, LOWER, LOWER + length, length, THICKNESS});
+    }
+
+    RulerRenderPool pool{RulerRenderer::Style{}, threadCount};
+    pool.render(tiles);
+
+    resetCounters();
+    const auto start = std::chrono::steady_clock::now();
+    for (int batch = 0; batch < batches; batch++)
+    {
+        pool.render(tiles);
+    }
+    const double SECONDS = nanosecondsSince(start) / 1e9;
+    const double TILES = static_cast<double>(batches) * TILES_PER_BATCH;
+
+    printf("%-10s %6d px %2u threads %12.0f tiles/s %9.1f allocs/tile %6.1f strokes/tile\n",
+           "tiles",
+           length,
+           threadCount,
+           TILES / SECONDS,
+           static_cast<double>(allocationCount) / TILES,
+           static_cast<double>(strokeCount) / TILES);
+
+    for (const RulerRenderer::Tile &tile : tiles) { cairo_surface_destroy(tile.surface); }
+}
+
+/**
+ * Times the functions of RulerCalculations on their own and prints the cost per call.
+ * The ranges are spread evenly on a log scale from tiny fractions up to 1e12.
+ * @param iterations The number of calls per function.
+ */
+static void benchmarkCalculations(int iterations)
+{
+    const double SIZE = 1920;
+    std::vector<double> spans(iterations);
+    for (int i = 0; i < iterations; i++)
+    {
+        spans[i] = pow(10, -3 + 15.0 * i / iterations);
+    }
+
+    // The results are summed, so the calls can't be optimised away
+    double sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (double span : spans)
+    {
+        sum += RulerCalculations::calculateInterval(-span / 3, span - span / 3, SIZE);
+    }
+    printf("%-20s %12.1f ns/call\n", "calculateInterval", nanosecondsSince(start) / iterations);
+
+    start = std::chrono::steady_clock::now();
+    for (double span : spans)
+    {
+        sum += RulerCalculations::intervalPixelSpacing(span / 10, -span / 3, span - span / 3, SIZE);
+    }
+    printf("%-20s %12.1f ns/call\n", "intervalPixelSpacing", nanosecondsSince(start) / iterations);
+
+    start = std::chrono::steady_clock::now();
+    for (double span : spans)
+    {
+        sum += RulerCalculations::scaleToRange(span / 7, -span / 3, span - span / 3, 0, SIZE);
+    }
+    printf("%-20s %12.1f ns/call\n", "scaleToRange", nanosecondsSince(start) / iterations);
+
+    // The batch version maps the positions of a thousand ticks per call
+    const size_t BATCH = 1000;
+    std::vector<double> mapped(BATCH);
+    const std::vector<std::pair<RulerCalculations::Kernel, const char *>> KERNELS{
+      {RulerCalculations::Kernel::SCALAR, "scalar"},
+      {RulerCalculations::Kernel::SSE4_1, "sse4.1"},
+      {RulerCalculations::Kernel::AVX2, "avx2"},
+    };
+    for (const auto &kernel : KERNELS)
+    {
+        if (!RulerCalculations::kernelSupported(kernel.first)) { continue; }
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i + BATCH <= spans.size(); i += BATCH)
+        {
+            RulerCalculations::scaleToRange(&spans[i], mapped.data(), BATCH, -1e6, 1e12, 0, SIZE, kernel.first);
+            sum += mapped[0];
+        }
+        printf("scaleToRange batch %-6s %6.2f ns/number\n", kernel.second, nanosecondsSince(start) / iterations);
+    }
+
+    printf("(checksum %g)\n", sum);
+}
+
+int main(int argc, char *argv[])
+{
+    // The number of frames per render benchmark can be given as the first argument
+    const int FRAMES = (argc > 1) ? std::max(1, atoi(argv[1])) : 100;
+
+    printf("==== Calculations ====\n");
+    benchmarkCalculations(1000000);
+
+    printf("\n==== Tick layout ====\n");
+    const int LAYOUTS = 2000;
+    for (const BenchRange &range : RANGES)
+    {
+        for (int length : SIZES)
+        {
+            benchmarkLayout(length, range, LAYOUTS);
+        }
+    }
+
+    // The tiles are rendered without a widget, so they don't need GTK
+    printf("\n==== Tiles ====\n");
+    const unsigned HARDWARE_THREADS = std::max(1U, std::thread::hardware_concurrency());
+    // Double the number of threads up to one per hardware thread
+    std::vector<unsigned> threadCounts;
+    for (unsigned threadCount = 1; threadCount < HARDWARE_THREADS; threadCount *= 2) { threadCounts.push_back(threadCount); }
+    threadCounts.push_back(HARDWARE_THREADS);
+    for (unsigned threadCount : threadCounts)
+    {
+        for (int length : {256, 1024})
+        {
+            benchmarkTiles(threadCount, length, std::max(1, FRAMES / 10));
+        }
+    }
+
+    // The ruler draws into an image surface, but needs GTK for its drawing area and style context
+    if (gtk_init_check(&argc, &argv) == FALSE)
+    {
+        printf("\nCould not initialise GTK, skipping the render benchmarks\n");
+        return 0;
+    }
+
+    // Every tick line used to be stroked on its own, so lines/frame is the
+    // number of strokes a frame would take without batching
+    printf("\n==== Rendering ====\n");
+    for (Ruler::Orientation orientation : {Ruler::HORIZONTAL, Ruler::VERTICAL})
+    {
+        for (const BenchRange &range : RANGES)
+        {
+            for (int length : SIZES)
+            {
+                for (Sequence sequence : {STATIC, PAN, SCROLL, ZOOM})
+                {
+                    benchmarkRender(orientation, length, range, sequence, FRAMES);
+                }
+            }
+        }
+    }
+
+
+    printf("\n==== Marker ====\n");
+    for (int length : SIZES)
+    {
+        benchmarkMarker(length, RANGES[2], 10 * FRAMES);
+    }
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include "glyphatlas.hh"
+
+#include <algorithm>
+#include <cmath>
+
+GlyphAtlas::~GlyphAtlas()
+{
+    clear();
+}
+
+void GlyphAtlas::setStyle(std::string_view newFontFamily, double newFontSize, const GdkRGBA &newColor, double newScale)
+{
+    if (newFontFamily == fontFamily && newFontSize == fontSize && gdk_rgba_equal(&newColor, &color) && newScale == scale)
+    {
+        return;
+    }
+
+    fontFamily = newFontFamily;
+    fontSize   = newFontSize;
+    color      = newColor;
+    scale      = newScale;
+    clear();
+}
+
+bool GlyphAtlas::covers(const char *label)
+{
+    if (*label == '\0') { return false; }
+
+    for (const char *character = label; *character != '\0'; character++)
+    {
+        if (indexOf(*character) < 0) { return false; }
+    }
+    return true;
+}
+
+cairo_text_extents_t GlyphAtlas::getExtents(cairo_t *cr, const char *label)
+{
+    if (surface == nullptr) { render(cr); }
+
+    // The characters are laid out one after the other, as Cairo's toy text API does
+    cairo_text_extents_t extents{};
+    double pen = 0;
+    bool hasInk = false;
+    double left = 0;
+    double top = 0;
+    double right = 0;
+    double bottom = 0;
+    for (const char *character = label; *character != '\0'; character++)
+    {
+        const cairo_text_extents_t &glyph = glyphs.at(indexOf(*character)).extents;
+        if (glyph.width > 0 && glyph.height > 0)
+        {
+            const double GLYPH_LEFT = pen + glyph.x_bearing;
+            const double GLYPH_RIGHT = GLYPH_LEFT + glyph.width;
+            const double GLYPH_BOTTOM = glyph.y_bearing + glyph.height;
+            left   = hasInk ? std::min(left, GLYPH_LEFT) : GLYPH_LEFT;
+            top    = hasInk ? std::min(top, glyph.y_bearing) : glyph.y_bearing;
+            right  = hasInk ? std::max(right, GLYPH_RIGHT) : GLYPH_RIGHT;
+            bottom = hasInk ? std::max(bottom, GLYPH_BOTTOM) : GLYPH_BOTTOM;
+            hasInk = true;
+        }
+        pen += glyph.x_advance;
+        extents.y_advance += glyph.y_advance;
+    }
+
+    extents.x_bearing = left;
+    extents.y_bearing = top;
+    extents.width     = right - left;
+    extents.height    = bottom - top;
+    extents.x_advance = pen;
+    return extents;
+}
+
+void GlyphAtlas::drawLabel(cairo_t *cr, const char *label, double x, double y, bool rotated)
+{
+    if (surface == nullptr) { render(cr); }
+
+    double deviceX = x;
+    double deviceY = y;
+    cairo_user_to_device(cr, &deviceX, &deviceY);
+
+    // The baseline is aligned to whole pixels. Along the text, every character is
+    // copied from the cell rendered at the sub-pixel position closest to its own
+    double pen = rotated ? deviceY : deviceX;
+    const double BASELINE = round(rotated ? deviceX : deviceY);
+    const int FIRST_ROW = rotated ? SUBPIXEL_POSITIONS : 0;
+
+    // Copy the cells in device space, so they stay aligned to whole pixels
+    cairo_save(cr);
+    cairo_identity_matrix(cr);
+    for (const char *character = label; *character != '\0'; character++)
+    {
+        const int INDEX = indexOf(*character);
+        const double QUANTIZED = round(pen * SUBPIXEL_POSITIONS) / SUBPIXEL_POSITIONS;
+        const double PIXEL = floor(QUANTIZED);
+        const auto POSITION = static_cast<int>(lround((QUANTIZED - PIXEL) * SUBPIXEL_POSITIONS));
+
+        const double CELL_X = INDEX * cellSize;
+        const double CELL_Y = (FIRST_ROW + POSITION) * cellSize;
+        const double DESTINATION_X = (rotated ? BASELINE : PIXEL) - originX;
+        const double DESTINATION_Y = (rotated ? PIXEL : BASELINE) - originY;
+        cairo_set_source_surface(cr, surface, DESTINATION_X - CELL_X, DESTINATION_Y - CELL_Y);
+        cairo_rectangle(cr, DESTINATION_X, DESTINATION_Y, cellSize, cellSize);
+        cairo_fill(cr);
+
+        // Rotating by -90 degrees turns the direction of the text from left-to-right into bottom-to-top
+        const double ADVANCE = glyphs.at(INDEX).extents.x_advance;
+        pen += rotated ? -ADVANCE : ADVANCE;
+    }
+    cairo_restore(cr);
+}
+
+void GlyphAtlas::clear()
+{
+    if (surface != nullptr)
+    {
+        cairo_surface_destroy(surface);
+        surface = nullptr;
+    }
+}
+
+int GlyphAtlas::indexOf(char character)
+{
+    const size_t INDEX = CHARACTERS.find(character);
+    return INDEX == std::string_view::npos ? -1 : static_cast<int>(INDEX);
+}
+
+void GlyphAtlas::render(cairo_t *cr)
+{
+    // Measure every character on its own, and find the bounds of the ink of all of them
+    std::array<char, 2> text{};
+    double left = 0;
+    double top = 0;
+    double right = 0;
+    double bottom = 0;
+    cairo_save(cr);
+    selectFont(cr);
+    for (size_t i = 0; i < CHARACTERS.size(); i++)
+    {
+        text[0] = CHARACTERS[i];
+        cairo_text_extents_t &extents = glyphs.at(i).extents;
+        cairo_text_extents(cr, text.data(), &extents);
+        left   = std::min(left, extents.x_bearing);
+        top    = std::min(top, extents.y_bearing);
+        right  = std::max(right, extents.x_bearing + extents.width);
+        bottom = std::max(bottom, extents.y_bearing + extents.height);
+    }
+    cairo_restore(cr);
+
+    // The cells are square, so they fit the characters both as they are and rotated by -90 degrees,
+    // which maps (x, y) to (y, -x). One extra pixel leaves room for the sub-pixel position
+    const double MIN_X = std::min(left, top);
+    const double MIN_Y = std::min(top, -right);
+    const double MAX_X = std::max(right, bottom);
+    const double MAX_Y = std::max(bottom, -left);
+    originX  = PADDING - floor(MIN_X);
+    originY  = PADDING - floor(MIN_Y);
+    cellSize = static_cast<int>(std::max(ceil(MAX_X) - floor(MIN_X), ceil(MAX_Y) - floor(MIN_Y))) + 2 * PADDING + 1;
+
+    const auto COLUMNS = static_cast<int>(CHARACTERS.size());
+    const int ROWS = 2 * SUBPIXEL_POSITIONS;
+    clear();
+    surface = cairo_surface_create_similar(cairo_get_target(cr), CAIRO_CONTENT_COLOR_ALPHA, COLUMNS * cellSize, ROWS * cellSize);
+
+    cairo_t *atlasCr = cairo_create(surface);
+    selectFont(atlasCr);
+    gdk_cairo_set_source_rgba(atlasCr, &color);
+    for (int row = 0; row < ROWS; row++)
+    {
+        const bool ROTATED = row >= SUBPIXEL_POSITIONS;
+        const double SUBPIXEL = static_cast<double>(row % SUBPIXEL_POSITIONS) / SUBPIXEL_POSITIONS;
+        for (int column = 0; column < COLUMNS; column++)
+        {
+            text[0] = CHARACTERS[column];
+            const double X = column * cellSize + originX + (ROTATED ? 0 : SUBPIXEL);
+            const double Y = row * cellSize + originY + (ROTATED ? SUBPIXEL : 0);
+
+            cairo_save(atlasCr);
+            cairo_move_to(atlasCr, X, Y);
+            if (ROTATED) { cairo_rotate(atlasCr, -M_PI / 2); }
+            cairo_show_text(atlasCr, text.data());
+            cairo_restore(atlasCr);
+        }
+    }
+    cairo_destroy(atlasCr);
+}
+
+void GlyphAtlas::selectFont(cairo_t *cr) const
+{
+    cairo_select_font_face(cr, fontFamily.c_str(), CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, fontSize);
+}
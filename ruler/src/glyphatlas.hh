@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+
+#include <gtk/gtk.h>
+
+/**
+ * This class renders the characters tick labels are made of once, into a single surface, and
+ * composes labels by copying the cells of their characters. The advances of the characters are
+ * measured once as well, so the extents of a label are calculated by adding them up, without
+ * shaping any text. The atlas is rendered again when the font, colour or scale changes.
+ *
+ * Characters are rendered at a number of sub-pixel positions along the direction of the text,
+ * and their baseline is aligned to whole pixels. Labels composed from the atlas can therefore
+ * differ slightly from labels drawn by Cairo directly.
+ */
+class GlyphAtlas
+{
+public:
+    /** The characters in the atlas. Labels with any other character can't be drawn from the atlas. */
+    static constexpr std::string_view CHARACTERS{"0123456789-."};
+
+    /** The number of sub-pixel positions along the direction of the text each character is rendered at. */
+    static constexpr int SUBPIXEL_POSITIONS{4};
+
+    GlyphAtlas() = default;
+    ~GlyphAtlas();
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas(GlyphAtlas&&)      = delete;
+    GlyphAtlas operator=(const GlyphAtlas&) = delete;
+    GlyphAtlas operator=(GlyphAtlas&&) = delete;
+
+    /**
+     * Sets the style the characters are rendered with. Clears the atlas if the style has changed.
+     * @param fontFamily The font family of the labels.
+     * @param fontSize The font size of the labels.
+     * @param color The colour of the labels.
+     * @param scale The device scale of the surface the labels are drawn to.
+     */
+    void setStyle(std::string_view fontFamily, double fontSize, const GdkRGBA &color, double scale);
+
+    /**
+     * Returns whether a label consists of characters in the atlas only.
+     * @param label The label. Must be null-terminated.
+     * @return True if \p label can be drawn from the atlas.
+     */
+    [[nodiscard]] static bool covers(const char *label);
+
+    /**
+     * Returns the extents of a label, calculated from the metrics of its characters.
+     * @param cr Cairo context the label will be drawn to. Only used to render the atlas if it isn't yet.
+     * @param label The label to measure. Must be null-terminated and covered by the atlas.
+     * @return The extents of \p label.
+     */
+    cairo_text_extents_t getExtents(cairo_t *cr, const char *label);
+
+    /**
+     * Draws a label by copying the cells of its characters from the atlas.
+     * @param cr Cairo context to draw to.
+     * @param label The label to draw. Must be null-terminated and covered by the atlas.
+     * @param x The x-coordinate of the origin of the label.
+     * @param y The y-coordinate of the origin of the label.
+     * @param rotated True if the label should be drawn from bottom-to-top instead of left-to-right.
+     */
+    void drawLabel(cairo_t *cr, const char *label, double x, double y, bool rotated);
+
+    /**
+     * Releases the rendered atlas. It is rendered again when it is next used.
+     */
+    void clear();
+
+private:
+    /** The metrics of a character. */
+    struct Glyph
+    {
+        cairo_text_extents_t extents{};
+    };
+
+    /** Empty space around a cell in pixels, which leaves room for antialiasing. */
+    static constexpr int PADDING{2};
+
+    /**
+     * The atlas. Every character has a column of cells, one row for each sub-pixel position,
+     * first for left-to-right text and then for bottom-to-top text.
+     */
+    cairo_surface_t *surface{};
+
+    std::array<Glyph, CHARACTERS.size()> glyphs{};
+
+    /** The width and height of a cell in pixels. */
+    int cellSize{};
+
+    // Position of the origin of a character within its cell in whole pixels.
+    double originX{};
+    double originY{};
+
+    std::string fontFamily{"sans-serif"};
+    double      fontSize{11};
+    GdkRGBA     color{0, 0, 0, 1};
+    double      scale{1};
+
+    /**
+     * Returns the index of a character in the atlas.
+     * @param character The character.
+     * @return The index of \p character in CHARACTERS, or -1 if it isn't in the atlas.
+     */
+    static int indexOf(char character);
+
+    /**
+     * Measures the characters and renders them into the atlas.
+     * @param cr Cairo context the labels will be drawn to.
+     */
+    void render(cairo_t *cr);
+
+    /**
+     * Selects the font of the labels on a Cairo context.
+     * @param cr The Cairo context.
+     */
+    void selectFont(cairo_t *cr) const;
+};
@@ -0,0 +1,452 @@
+#include "labelcache.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "rulerstats.hh"
+
+LabelCache::~LabelCache()
+{
+    clear();
+    releasePangoContext();
+}
+
+void LabelCache::setStyle(std::string_view newFontFamily, double newFontSize, const GdkRGBA &newColor, double newScale)
+{
+    if (newFontFamily == fontFamily && newFontSize == fontSize && gdk_rgba_equal(&newColor, &color) && newScale == scale)
+    {
+        return;
+    }
+
+    metricsValid = metricsValid && newFontFamily == fontFamily && newFontSize == fontSize;
+    fontFamily = newFontFamily;
+    fontSize   = newFontSize;
+    color      = newColor;
+    scale      = newScale;
+    clear();
+    atlas.setStyle(fontFamily, fontSize, color, scale);
+}
+
+void LabelCache::setEnabled(bool enable)
+{
+    enabled = enable;
+    clear();
+}
+
+void LabelCache::setGlyphAtlasEnabled(bool enable)
+{
+    glyphAtlasEnabled = enable;
+    if (!enable) { atlas.clear(); }
+}
+
+bool LabelCache::setPangoContext(PangoContext *context)
+{
+    if (context == pangoContext)
+    {
+        if (context == nullptr) { return false; }
+
+        // The context of a widget follows the style of the widget, so its font may have changed
+        if (pango_font_description_equal(pango_context_get_font_description(context), pangoFont) != FALSE
+            && pango_cairo_context_get_resolution(context) == pangoResolution)
+        {
+            return false;
+        }
+    }
+
+    if (context != nullptr) { g_object_ref(context); }
+    clear();
+    releasePangoContext();
+    if (context != nullptr)
+    {
+        pangoContext    = context;
+        pangoFont       = pango_font_description_copy(pango_context_get_font_description(context));
+        pangoResolution = pango_cairo_context_get_resolution(context);
+    }
+    metricsValid = false;
+    return true;
+}
+
+cairo_text_extents_t LabelCache::getExtents(cairo_t *cr, const char *label)
+{
+    if (usesAtlas(label)) { return atlas.getExtents(cr, label); }
+    if (enabled)
+    {
+        const Entry *entry = lookup(cr, label);
+        if (entry != nullptr) { return entry->extents; }
+    }
+
+    if (pangoContext != nullptr) { return layoutExtents(uncachedLayoutFor(label)); }
+
+    cairo_text_extents_t extents;
+    cairo_save(cr);
+    selectFont(cr);
+    cairo_text_extents(cr, label, &extents);
+    cairo_restore(cr);
+    return extents;
+}
+
+void LabelCache::insertExtents(const char *label, const cairo_text_extents_t &extents)
+{
+    // Extents measured elsewhere are measured with Cairo's toy text API
+    if (!enabled || usesAtlas(label) || pangoContext != nullptr) { return; }
+
+    bool found = false;
+    Entry *entry = entryFor(label, found);
+    if (entry != nullptr && !found) { entry->extents = extents; }
+}
+
+const LabelCache::Metrics &LabelCache::getMetrics()
+{
+    if (!metricsValid)
+    {
+        measureMetrics();
+        metricsValid = true;
+    }
+    return metrics;
+}
+
+double LabelCache::Metrics::estimateAdvance(const char *label) const
+{
+    double advance = 0;
+    for (const char *character = label; *character != '\0'; character++) { advance += (*character == '-') ? minusAdvance : digitAdvance; }
+    return advance;
+}
+
+void LabelCache::drawLabel(cairo_t *cr, const char *label, double x, double y, bool rotated)
+{
+    if (!enabled)
+    {
+        showLabel(cr, label, (pangoContext != nullptr) ? uncachedLayoutFor(label) : nullptr, x, y, rotated);
+        return;
+    }
+
+    if (usesAtlas(label))
+    {
+        RULER_STAT(stats.hits++);
+        atlas.drawLabel(cr, label, x, y, rotated);
+        return;
+    }
+
+    Entry *entry = lookup(cr, label);
+    if (entry == nullptr)
+    {
+        RULER_STAT(stats.misses++);
+        showLabel(cr, label, (pangoContext != nullptr) ? uncachedLayoutFor(label) : nullptr, x, y, rotated);
+        return;
+    }
+
+    // Glyphs are rasterized differently depending on their sub-pixel position, so the
+    // pre-rendered label can only be reused for the same sub-pixel offset
+    double deviceX = x;
+    double deviceY = y;
+    cairo_user_to_device(cr, &deviceX, &deviceY);
+    const double PIXEL_X = floor(deviceX);
+    const double PIXEL_Y = floor(deviceY);
+    const double PHASE_X = deviceX - PIXEL_X;
+    const double PHASE_Y = deviceY - PIXEL_Y;
+
+    if (!entry->rendered || entry->phaseX != PHASE_X || entry->phaseY != PHASE_Y || entry->rotated != rotated)
+    {
+        RULER_STAT(stats.misses++);
+        entry->rendered = renderEntry(cr, *entry, PHASE_X, PHASE_Y, rotated);
+    }
+    else
+    {
+        RULER_STAT(stats.hits++);
+    }
+
+    if (!entry->rendered)
+    {
+        showLabel(cr, label, entry->layout, x, y, rotated);
+        return;
+    }
+
+    // Copy the pre-rendered label from its cell in device space, so it stays aligned to whole pixels
+    double cellX{};
+    double cellY{};
+    cellPosition(*entry, rotated, cellX, cellY);
+    const double DESTINATION_X = PIXEL_X - entry->originX;
+    const double DESTINATION_Y = PIXEL_Y - entry->originY;
+    cairo_save(cr);
+    cairo_identity_matrix(cr);
+    cairo_set_source_surface(cr, cellSurfaces.at(rotated ? 1 : 0), DESTINATION_X - cellX, DESTINATION_Y - cellY);
+    cairo_rectangle(cr, DESTINATION_X, DESTINATION_Y, entry->width, entry->height);
+    cairo_fill(cr);
+    cairo_restore(cr);
+}
+
+void LabelCache::clear()
+{
+    for (Entry &entry : entries)
+    {
+        if (entry.layout != nullptr) { g_object_unref(entry.layout); }
+        entry = Entry{};
+    }
+    for (size_t i = 0; i < cellSurfaces.size(); i++)
+    {
+        if (cellContexts.at(i) != nullptr) { cairo_destroy(cellContexts.at(i)); }
+        if (cellSurfaces.at(i) != nullptr) { cairo_surface_destroy(cellSurfaces.at(i)); }
+        cellContexts.at(i) = nullptr;
+        cellSurfaces.at(i) = nullptr;
+    }
+}
+
+const LabelCache::Stats &LabelCache::getStats() const
+{
+    return stats;
+}
+
+void LabelCache::resetStats()
+{
+    stats = Stats{};
+}
+
+LabelCache::Entry *LabelCache::lookup(cairo_t *cr, const char *label)
+{
+    bool found = false;
+    Entry *entry = entryFor(label, found);
+    if (entry == nullptr || found) { return entry; }
+
+    if (pangoContext != nullptr)
+    {
+        // The layout of the label that was here before is laid out again
+        if (entry->layout == nullptr) { entry->layout = pango_layout_new(pangoContext); }
+        pango_layout_set_text(entry->layout, label, -1);
+        entry->extents = layoutExtents(entry->layout);
+    }
+    else
+    {
+        cairo_save(cr);
+        selectFont(cr);
+        cairo_text_extents(cr, label, &entry->extents);
+        cairo_restore(cr);
+    }
+    return entry;
+}
+
+LabelCache::Entry *LabelCache::entryFor(const char *label, bool &found)
+{
+    const size_t LENGTH = strlen(label);
+    if (LENGTH >= RulerCalculations::LabelBuffer{}.size()) { return nullptr; }
+
+    // FNV-1a hash of the label, which selects its set
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < LENGTH; i++)
+    {
+        hash ^= static_cast<unsigned char>(label[i]);
+        hash *= 1099511628211ULL;
+    }
+    Entry *const SET = entries.data() + (hash % SETS) * WAYS;
+
+    useCount++;
+    Entry *oldest = SET;
+    for (Entry *entry = SET; entry < SET + WAYS; entry++)
+    {
+        if (entry->label[0] != '\0' && strcmp(entry->label.data(), label) == 0)
+        {
+            entry->lastUse = useCount;
+            found = true;
+            return entry;
+        }
+        if (entry->lastUse < oldest->lastUse) { oldest = entry; }
+    }
+
+    // Labels scroll by and are rarely needed again, so the label used longest ago makes way.
+    // The new label keeps the layout and the cell of the old one
+    found = false;
+    memcpy(oldest->label.data(), label, LENGTH + 1);
+    oldest->extents = cairo_text_extents_t{};
+    oldest->rendered = false;
+    oldest->lastUse = useCount;
+    return oldest;
+}
+
+cairo_surface_t *LabelCache::cellSurfaceFor(cairo_t *cr, bool rotated)
+{
+    const size_t INDEX = rotated ? 1 : 0;
+    if (cellSurfaces.at(INDEX) != nullptr) { return cellSurfaces.at(INDEX); }
+
+    // A cell has room for a number of the widest characters along the text, and for the digits across it.
+    // The metrics are measured at a scale of 1 and the labels at the scale they are drawn at, so with some to spare
+    const Metrics &METRICS = getMetrics();
+    cellLength = static_cast<int>(ceil(CELL_CHARACTERS * std::max(METRICS.digitAdvance, METRICS.minusAdvance))) + 3 * PADDING;
+    cellThickness = static_cast<int>(ceil(METRICS.digitBottom) - floor(METRICS.digitTop)) + 3 * PADDING;
+
+    const int CELL_WIDTH = rotated ? cellThickness : cellLength;
+    const int CELL_HEIGHT = rotated ? cellLength : cellThickness;
+    const size_t ROWS = (entries.size() + CELL_COLUMNS - 1) / CELL_COLUMNS;
+    cellSurfaces.at(INDEX) = cairo_surface_create_similar(cairo_get_target(cr),
+                                                          CAIRO_CONTENT_COLOR_ALPHA,
+                                                          static_cast<int>(CELL_COLUMNS) * CELL_WIDTH,
+                                                          static_cast<int>(ROWS) * CELL_HEIGHT);
+    cellContexts.at(INDEX) = cairo_create(cellSurfaces.at(INDEX));
+    return cellSurfaces.at(INDEX);
+}
+
+void LabelCache::cellPosition(const Entry &entry, bool rotated, double &cellX, double &cellY) const
+{
+    const auto INDEX = static_cast<size_t>(&entry - entries.data());
+    cellX = static_cast<double>(INDEX % CELL_COLUMNS) * (rotated ? cellThickness : cellLength);
+    cellY = static_cast<double>(INDEX / CELL_COLUMNS) * (rotated ? cellLength : cellThickness);
+}
+
+bool LabelCache::usesAtlas(const char *label) const
+{
+    // The atlas is rendered with Cairo's toy text API
+    return enabled && glyphAtlasEnabled && pangoContext == nullptr && GlyphAtlas::covers(label);
+}
+
+PangoLayout *LabelCache::uncachedLayoutFor(const char *label)
+{
+    if (uncachedLayout == nullptr) { uncachedLayout = pango_layout_new(pangoContext); }
+    pango_layout_set_text(uncachedLayout, label, -1);
+    return uncachedLayout;
+}
+
+cairo_text_extents_t LabelCache::layoutExtents(PangoLayout *layout)
+{
+    PangoRectangle ink;
+    PangoRectangle logical;
+    pango_layout_get_extents(layout, &ink, &logical);
+    const int BASELINE = pango_layout_get_baseline(layout);
+
+    // Pango measures from the top-left corner of the layout, Cairo from the origin of the text on its baseline
+    cairo_text_extents_t extents{};
+    extents.x_bearing = pango_units_to_double(ink.x);
+    extents.y_bearing = pango_units_to_double(ink.y - BASELINE);
+    extents.width     = pango_units_to_double(ink.width);
+    extents.height    = pango_units_to_double(ink.height);
+    extents.x_advance = pango_units_to_double(logical.width);
+    return extents;
+}
+
+void LabelCache::measureMetrics()
+{
+    // The metrics only depend on the font, so they are measured on a context of their own
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+    cairo_t *cr = cairo_create(surface);
+    selectFont(cr);
+
+    metrics = Metrics{};
+    std::array<char, 2> text{};
+    for (char character : std::string_view{"0123456789-"})
+    {
+        text[0] = character;
+        cairo_text_extents_t extents;
+        if (pangoContext != nullptr) { extents = layoutExtents(uncachedLayoutFor(text.data())); }
+        else { cairo_text_extents(cr, text.data(), &extents); }
+
+        if (character == '-')
+        {
+            metrics.minusAdvance = extents.x_advance;
+        }
+        else
+        {
+            metrics.digitAdvance = std::max(metrics.digitAdvance, extents.x_advance);
+            metrics.digitTop     = std::min(metrics.digitTop, extents.y_bearing);
+        }
+        metrics.digitBottom = std::max(metrics.digitBottom, extents.y_bearing + extents.height);
+    }
+
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+}
+
+void LabelCache::releasePangoContext()
+{
+    if (uncachedLayout != nullptr)
+    {
+        g_object_unref(uncachedLayout);
+        uncachedLayout = nullptr;
+    }
+    if (pangoFont != nullptr)
+    {
+        pango_font_description_free(pangoFont);
+        pangoFont = nullptr;
+    }
+    if (pangoContext != nullptr)
+    {
+        g_object_unref(pangoContext);
+        pangoContext = nullptr;
+    }
+    pangoResolution = 0;
+}
+
+bool LabelCache::renderEntry(cairo_t *cr, Entry &entry, double phaseX, double phaseY, bool rotated)
+{
+    const cairo_text_extents_t &extents = entry.extents;
+
+    // Bounds of the ink of the label relative to its origin
+    double left   = extents.x_bearing;
+    double top    = extents.y_bearing;
+    double right  = extents.x_bearing + extents.width;
+    double bottom = extents.y_bearing + extents.height;
+    if (rotated)
+    {
+        // Rotating by -90 degrees maps (x, y) to (y, -x)
+        left   = extents.y_bearing;
+        top    = -(extents.x_bearing + extents.width);
+        right  = extents.y_bearing + extents.height;
+        bottom = -extents.x_bearing;
+    }
+
+    // One extra pixel to leave room for the sub-pixel offset
+    const int WIDTH  = static_cast<int>(ceil(right) - floor(left)) + 2 * PADDING + 1;
+    const int HEIGHT = static_cast<int>(ceil(bottom) - floor(top)) + 2 * PADDING + 1;
+
+    cellSurfaceFor(cr, rotated);
+    if (WIDTH > (rotated ? cellThickness : cellLength) || HEIGHT > (rotated ? cellLength : cellThickness)) { return false; }
+
+    entry.width   = WIDTH;
+    entry.height  = HEIGHT;
+    entry.originX = PADDING - floor(left);
+    entry.originY = PADDING - floor(top);
+    entry.phaseX  = phaseX;
+    entry.phaseY  = phaseY;
+    entry.rotated = rotated;
+
+    // The cells lie at whole pixels, so the label is rasterized as it would be in a surface of its own
+    double cellX{};
+    double cellY{};
+    cellPosition(entry, rotated, cellX, cellY);
+    cairo_t *cellCr = cellContexts.at(rotated ? 1 : 0);
+    cairo_save(cellCr);
+    cairo_rectangle(cellCr, cellX, cellY, WIDTH, HEIGHT);
+    cairo_clip(cellCr);
+    cairo_set_operator(cellCr, CAIRO_OPERATOR_CLEAR);
+    cairo_paint(cellCr);
+    cairo_set_operator(cellCr, CAIRO_OPERATOR_OVER);
+    showLabel(cellCr, entry.label.data(), entry.layout, cellX + entry.originX + phaseX, cellY + entry.originY + phaseY, rotated);
+    cairo_restore(cellCr);
+    return true;
+}
+
+void LabelCache::showLabel(cairo_t *cr, const char *label, PangoLayout *layout, double x, double y, bool rotated) const
+{
+    // We'll be modifying the transformation matrix so
+    // we save the current one to restore later
+    cairo_save(cr);
+    gdk_cairo_set_source_rgba(cr, &color);
+    cairo_move_to(cr, x, y);
+    if (rotated) { cairo_rotate(cr, -M_PI / 2); }
+    if (layout != nullptr)
+    {
+        // Pango draws a layout from its top-left corner, so move up from the baseline
+        cairo_rel_move_to(cr, 0, -pango_units_to_double(pango_layout_get_baseline(layout)));
+        pango_cairo_show_layout(cr, layout);
+    }
+    else
+    {
+        selectFont(cr);
+        cairo_show_text(cr, label);
+    }
+    cairo_restore(cr);
+}
+
+void LabelCache::selectFont(cairo_t *cr) const
+{
+    cairo_select_font_face(cr, fontFamily.c_str(), CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, fontSize);
+}
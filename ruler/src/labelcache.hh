@@ -0,0 +1,343 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <gtk/gtk.h>
+
+#include "glyphatlas.hh"
+#include "rulercalculations.hh"
+
+/**
+ * This class caches the extents and a pre-rendered image of tick labels,
+ * so that labels don't have to be measured and shaped every time they are drawn.
+ * The cache is invalidated when the font, colour or scale changes.
+ *
+ * The cache has a fixed number of entries, and the labels are rendered into cells of a
+ * single surface, one cell per entry. A label that doesn't fit in a cell is drawn directly.
+ * A new label takes the place of the label in its set of entries that was used longest ago,
+ * and is rendered into the cell of that label, so once the cells exist, drawing labels that
+ * were never drawn before doesn't allocate any memory in the cache either. (Cairo and Pango
+ * may still allocate memory of their own to render the text.)
+ *
+ * Optionally, numeric labels are composed from a GlyphAtlas instead, so a label
+ * that was never drawn before doesn't have to be measured or rendered either.
+ *
+ * Labels are laid out with Cairo's toy text API in the font family and size of the
+ * style, unless a Pango context is set. Then they are laid out with Pango in the font
+ * of that context, and the layout of every label is kept, so it is measured only once.
+ */
+class LabelCache
+{
+public:
+    /** Counts of the labels drawn through the cache. Only collected if SCROOMRULER_STATS is defined. */
+    struct Stats
+    {
+        /** The number of labels drawn from a pre-rendered surface or the glyph atlas. */
+        uint64_t hits{};
+
+        /** The number of labels that had to be rendered first. */
+        uint64_t misses{};
+    };
+
+    /** The metrics of the characters of numeric labels, from which the size of a label is estimated without measuring it. */
+    struct Metrics
+    {
+        /** The advance of the widest digit. */
+        double digitAdvance{};
+
+        /** The advance of a minus sign. */
+        double minusAdvance{};
+
+        /** The top of the highest digit relative to the baseline. Negative, like the y_bearing of cairo_text_extents_t. */
+        double digitTop{};
+
+        /** The bottom of the lowest digit or minus sign relative to the baseline. */
+        double digitBottom{};
+
+        /**
+         * Estimates the advance of a numeric label. Every character but a minus sign counts as the widest digit,
+         * so the estimate is never less than the actual advance of the label.
+         * @param label The label. Must be null-terminated.
+         * @return The estimated advance of \p label.
+         */
+        [[nodiscard]] double estimateAdvance(const char *label) const;
+    };
+
+    LabelCache() = default;
+    ~LabelCache();
+    LabelCache(const LabelCache&) = delete;
+    LabelCache(LabelCache&&)      = delete;
+    LabelCache operator=(const LabelCache&) = delete;
+    LabelCache operator=(LabelCache&&) = delete;
+
+    /**
+     * Sets the style labels are drawn with. Clears the cache if the style has changed.
+     * @param fontFamily The font family of the labels.
+     * @param fontSize The font size of the labels.
+     * @param color The colour of the labels.
+     * @param scale The device scale of the surface the labels are drawn to.
+     */
+    void setStyle(std::string_view fontFamily, double fontSize, const GdkRGBA &color, double scale);
+
+    /**
+     * Enables or disables the cache. When disabled, every label is measured and rendered with Cairo directly.
+     * @param enable True to enable the cache.
+     */
+    void setEnabled(bool enable);
+
+    /**
+     * Enables or disables composing numeric labels from a glyph atlas. Only has an effect while the cache is enabled.
+     * Labels composed from the atlas can differ slightly from labels rendered by Cairo; see GlyphAtlas.
+     * @param enable True to compose numeric labels from the glyph atlas.
+     */
+    void setGlyphAtlasEnabled(bool enable);
+
+    /**
+     * Sets the Pango context labels are laid out in, such as the context of a widget. Clears the cache if the
+     * context, or its font or resolution, has changed since the last call.
+     * @param context The Pango context, or null to lay out labels with Cairo's toy text API.
+     * @return True if the labels will be laid out again.
+     */
+    bool setPangoContext(PangoContext *context);
+
+    /**
+     * Returns the extents of a label as Cairo would measure them.
+     * @param cr Cairo context the label will be drawn to.
+     * @param label The label to measure. Must be null-terminated.
+     * @return The extents of \p label.
+     */
+    cairo_text_extents_t getExtents(cairo_t *cr, const char *label);
+
+    /**
+     * Adds the extents of a label that were measured elsewhere, such as on another thread,
+     * so they don't have to be measured when the label is drawn. Does nothing if the label
+     * is already cached or the cache is disabled.
+     * @param label The label. Must be null-terminated.
+     * @param extents The extents of \p label as Cairo would measure them in the current style.
+     */
+    void insertExtents(const char *label, const cairo_text_extents_t &extents);
+
+    /**
+     * Returns the metrics of the characters of numeric labels in the current font. They are measured once,
+     * at a scale of 1, so they don't depend on the surface the labels are drawn to.
+     * @return The metrics of the characters of numeric labels.
+     */
+    const Metrics &getMetrics();
+
+    /**
+     * Draws a label.
+     * @param cr Cairo context to draw to.
+     * @param label The label to draw. Must be null-terminated.
+     * @param x The x-coordinate of the origin of the label.
+     * @param y The y-coordinate of the origin of the label.
+     * @param rotated True if the label should be drawn from bottom-to-top instead of left-to-right.
+     */
+    void drawLabel(cairo_t *cr, const char *label, double x, double y, bool rotated);
+
+    /**
+     * Removes all labels from the cache, and releases the surfaces they were rendered into.
+     */
+    void clear();
+
+    /**
+     * Returns the counts of the labels drawn through the cache.
+     * @return The counts of the labels drawn through the cache.
+     */
+    [[nodiscard]] const Stats &getStats() const;
+
+    /**
+     * Resets the counts of the labels drawn through the cache to zero.
+     */
+    void resetStats();
+
+private:
+    struct Entry
+    {
+        /** The label. Empty if the entry is unused. */
+        RulerCalculations::LabelBuffer label{};
+
+        cairo_text_extents_t extents{};
+
+        /** The label laid out with Pango, if a Pango context is set. Reused by the next label of the entry. */
+        PangoLayout *layout{};
+
+        /** True if the label is rendered into the cell of the entry. Rendered on first use. */
+        bool rendered{};
+
+        // The size of the rendered label in pixels
+        int width{};
+        int height{};
+
+        // Position of the label origin within the cell in whole pixels
+        double originX{};
+        double originY{};
+
+        // Sub-pixel offset of the label origin the cell was rendered with
+        double phaseX{};
+        double phaseY{};
+
+        bool rotated{};
+
+        /** When the entry was last used, in lookups since the cache was created. */
+        uint64_t lastUse{};
+    };
+
+    /** The number of entries a label can be stored in. */
+    static constexpr size_t WAYS{4};
+
+    /** The number of sets of entries. A label is stored in the set its hash selects. */
+    static constexpr size_t SETS{64};
+
+    /** The number of cells in a row of the surface the labels are rendered into. */
+    static constexpr size_t CELL_COLUMNS{16};
+
+    /** The number of characters of the widest digit a cell has room for along the text. */
+    static constexpr int CELL_CHARACTERS{12};
+
+    /** Empty space around a pre-rendered label in pixels, which leaves room for antialiasing. */
+    static constexpr int PADDING{2};
+
+    std::array<Entry, SETS * WAYS> entries{};
+
+    /** The number of lookups since the cache was created. */
+    uint64_t useCount{};
+
+    /**
+     * The surfaces the labels are rendered into, one cell per entry. The first is for left-to-right
+     * labels and the second for bottom-to-top labels, whose cells are rotated. Created on first use.
+     */
+    std::array<cairo_surface_t *, 2> cellSurfaces{};
+
+    /** Cairo contexts that draw to cellSurfaces, kept so that rendering a label doesn't create one. */
+    std::array<cairo_t *, 2> cellContexts{};
+
+    // The size of a cell of left-to-right labels in pixels. The cells of bottom-to-top labels are rotated
+    int cellLength{};
+    int cellThickness{};
+
+    bool enabled{true};
+
+    /** The characters of numeric labels, if glyphAtlasEnabled. */
+    GlyphAtlas atlas;
+
+    bool glyphAtlasEnabled{false};
+
+    /** The context labels are laid out in, or null to lay them out with Cairo's toy text API. */
+    PangoContext *pangoContext{};
+
+    // The font and resolution of pangoContext when the labels were laid out
+    PangoFontDescription *pangoFont{};
+    double                pangoResolution{};
+
+    /** Layout reused for every label while the cache is disabled. Created on first use. */
+    PangoLayout *uncachedLayout{};
+
+    Stats stats;
+
+    /** The metrics of the characters of numeric labels, if metricsValid. */
+    Metrics metrics;
+
+    /** False if the metrics have to be measured before they are used, because the font has changed. */
+    bool metricsValid{false};
+
+    std::string fontFamily{"sans-serif"};
+    double      fontSize{11};
+    GdkRGBA     color{0, 0, 0, 1};
+    double      scale{1};
+
+    /**
+     * Returns the entry for a label, measuring the label if it isn't cached yet.
+     * @param cr Cairo context the label will be drawn to.
+     * @param label The label to look up.
+     * @return The entry for \p label, or null if \p label is too long to be cached.
+     */
+    Entry *lookup(cairo_t *cr, const char *label);
+
+    /**
+     * Returns the entry a label is stored in. If the label isn't cached, this is the entry of its set that
+     * was used longest ago, which is emptied and given the label, but not measured.
+     * @param label The label. Must be null-terminated.
+     * @param found Set to true if the label was cached already.
+     * @return The entry for \p label, or null if \p label is too long to be cached.
+     */
+    Entry *entryFor(const char *label, bool &found);
+
+    /**
+     * Returns the surface a label is rendered into, creating it if it doesn't exist yet.
+     * @param cr Cairo context the label will be drawn to.
+     * @param rotated True for the surface of bottom-to-top labels.
+     * @return The surface of the cells of \p rotated labels.
+     */
+    cairo_surface_t *cellSurfaceFor(cairo_t *cr, bool rotated);
+
+    /**
+     * Returns the position of the cell of an entry in the surface of its labels.
+     * @param entry The entry.
+     * @param rotated True for the cell in the surface of bottom-to-top labels.
+     * @param cellX Set to the x-coordinate of the cell.
+     * @param cellY Set to the y-coordinate of the cell.
+     */
+    void cellPosition(const Entry &entry, bool rotated, double &cellX, double &cellY) const;
+
+    /**
+     * Returns whether a label is composed from the glyph atlas.
+     * @param label The label. Must be null-terminated.
+     * @return True if \p label is drawn from the glyph atlas instead of a pre-rendered surface.
+     */
+    [[nodiscard]] bool usesAtlas(const char *label) const;
+
+    /**
+     * Returns the layout used while the cache is disabled, set to a label.
+     * @param label The label. Must be null-terminated.
+     * @return The layout of \p label.
+     */
+    PangoLayout *uncachedLayoutFor(const char *label);
+
+    /**
+     * Measures a Pango layout the way Cairo measures text, relative to the origin of the label on its baseline.
+     * @param layout The layout to measure.
+     * @return The extents of \p layout.
+     */
+    static cairo_text_extents_t layoutExtents(PangoLayout *layout);
+
+    /**
+     * Measures the metrics of the characters of numeric labels in the current font.
+     */
+    void measureMetrics();
+
+    /**
+     * Releases the Pango context, and everything laid out in it.
+     */
+    void releasePangoContext();
+
+    /**
+     * Renders the label of an entry into its cell.
+     * @param cr Cairo context the label will be drawn to.
+     * @param entry The entry to render.
+     * @param phaseX Sub-pixel x-offset of the label origin.
+     * @param phaseY Sub-pixel y-offset of the label origin.
+     * @param rotated True if the label should be rendered from bottom-to-top instead of left-to-right.
+     * @return True if the label was rendered, false if it doesn't fit in a cell.
+     */
+    bool renderEntry(cairo_t *cr, Entry &entry, double phaseX, double phaseY, bool rotated);
+
+    /**
+     * Draws a label with Cairo or Pango directly, without using the cache.
+     * @param cr Cairo context to draw to.
+     * @param label The label to draw.
+     * @param layout The label laid out with Pango, or null to draw it with Cairo's toy text API.
+     * @param x The x-coordinate of the origin of the label.
+     * @param y The y-coordinate of the origin of the label.
+     * @param rotated True if the label should be drawn from bottom-to-top instead of left-to-right.
+     */
+    void showLabel(cairo_t *cr, const char *label, PangoLayout *layout, double x, double y, bool rotated) const;
+
+    /**
+     * Selects the font of the labels on a Cairo context.
+     * @param cr The Cairo context.
+     */
+    void selectFont(cairo_t *cr) const;
+};
@@ -1,8 +1,12 @@
 #include "ruler.hh"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 
+#include "rulerstats.hh"
+
 //#include <scroom/assertions.hh>
 
 ////////////////////////////////////////////////////////////////////////
@@ -19,12 +23,15 @@ Ruler::Ruler(Ruler::Orientation orientation, GtkWidget* drawingAreaWidget)
         , orientation{orientation}
         , width{gtk_widget_get_allocated_width(drawingAreaWidget)}
         , height{gtk_widget_get_allocated_height(drawingAreaWidget)}
+        , scaleFactor{gtk_widget_get_scale_factor(drawingAreaWidget)}
 {
     //require(drawingArea != nullptr); // NOLINT(cppcoreguidelines-pro-bounds-array-to-pointer-decay,hicpp-no-array-decay)
 
     // Connect signal handlers
     g_signal_connect(drawingAreaWidget, "draw", G_CALLBACK(drawCallback), this); // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
     g_signal_connect(drawingAreaWidget, "size-allocate", G_CALLBACK(sizeAllocateCallback), this); // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+    g_signal_connect(drawingAreaWidget, "notify::scale-factor", G_CALLBACK(scaleFactorCallback), this); // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+    g_signal_connect(drawingAreaWidget, "style-updated", G_CALLBACK(styleUpdatedCallback), this); // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
     // Calculate tick intervals and spacing
     calculateTickIntervals();
 }
@@ -33,27 +40,346 @@ Ruler::~Ruler()
 {
     // Disconnect all signal handlers for this object from the drawing area
     g_signal_handlers_disconnect_by_data(drawingArea, this);
+    if (tickCallbackId != 0) { gtk_widget_remove_tick_callback(drawingArea, tickCallbackId); }
+    if (zoomTransitionCallbackId != 0) { gtk_widget_remove_tick_callback(drawingArea, zoomTransitionCallbackId); }
+
+    endZoomTransition();
+    clearTickCache();
 }
 
 void Ruler::setRange(double lower, double upper)
 {
     lowerLimit = lower;
     upperLimit = upper;
+    scrollRemainder = 0;
 
-    calculateTickIntervals();
+    requestUpdate();
+}
 
-    // We need to manually trigger the widget to redraw
-    gtk_widget_queue_draw(drawingArea);
+void Ruler::scrollBy(double delta)
+{
+    const double DRAW_AREA_SIZE = (orientation == HORIZONTAL) ? width : height;
+    const double PIXEL_SIZE = (upperLimit - lowerLimit) / DRAW_AREA_SIZE;
+
+    // An update that is already pending calculates the tick intervals for the new range anyway
+    if (updatePending || majorInterval <= 0 || !std::isfinite(PIXEL_SIZE) || PIXEL_SIZE <= 0)
+    {
+        lowerLimit += scrollRemainder + delta;
+        upperLimit += scrollRemainder + delta;
+        scrollRemainder = 0;
+        requestUpdate();
+        return;
+    }
+
+    // The range is only moved by whole pixels, so the rendered ticks can always be moved along with it.
+    // The rest is carried over to the next scroll
+    scrollRemainder += delta;
+    const double PIXELS = trunc(scrollRemainder / PIXEL_SIZE + copysign(SCROLL_PIXEL_EPSILON, scrollRemainder));
+    if (PIXELS == 0) { return; }
+    lowerLimit += PIXELS * PIXEL_SIZE;
+    upperLimit += PIXELS * PIXEL_SIZE;
+    scrollRemainder -= PIXELS * PIXEL_SIZE;
+
+    // The size of the range is unchanged, so the interval only changes if the labels at the new ends need
+    // another amount of space or decimals. Checking that formats those two labels and adds up the advances
+    // of their characters. The spacing is calculated again, as it may round differently for the moved range
+    majorTickSpacing = RulerCalculations::intervalPixelSpacing(majorInterval, lowerLimit, upperLimit, DRAW_AREA_SIZE);
+    if (RulerCalculations::labelDecimals(majorInterval, lowerLimit, upperLimit) != labelDecimals
+        || renderer.labelSpace(lowerLimit, upperLimit, majorInterval, labelDecimals) != labelSpace)
+    {
+        requestUpdate();
+        return;
+    }
+
+    updateCounters.updates++;
+    updateCounters.scrolls++;
+    invalidateChanges();
 }
 
 double Ruler::getLowerLimit() const
 {
-    return lowerLimit;
+    return lowerLimit + scrollRemainder;
 }
 
 double Ruler::getUpperLimit() const
 {
-    return upperLimit;
+    return upperLimit + scrollRemainder;
+}
+
+void Ruler::setMarkerPosition(double position)
+{
+    if (position == markerPosition || (std::isnan(position) && std::isnan(markerPosition))) { return; }
+
+    // Only the old and new marker have to be redrawn. The ticks
+    // underneath them are painted from the tick cache
+    const double OLD_PIXEL_POSITION = markerPixelPosition();
+    markerPosition = position;
+    invalidateMarker(OLD_PIXEL_POSITION);
+    invalidateMarker(markerPixelPosition());
+}
+
+double Ruler::getMarkerPosition() const
+{
+    return markerPosition;
+}
+
+void Ruler::setScaleFactor(int newScaleFactor)
+{
+    if (newScaleFactor == scaleFactor) { return; }
+    scaleFactor = newScaleFactor;
+
+    // The cached surfaces no longer match the device resolution. They are
+    // rendered once at the new scale factor when the ruler is drawn again
+    endZoomTransition();
+    clearTickCache();
+    gtk_widget_queue_draw(drawingArea);
+}
+
+cairo_surface_t *Ruler::getTickCache() const
+{
+    return tickCache;
+}
+
+void Ruler::setLabelCacheEnabled(bool enabled)
+{
+    renderer.setLabelCacheEnabled(enabled);
+
+    // The labels in the tick cache have to be drawn again
+    endZoomTransition();
+    clearTickCache();
+    gtk_widget_queue_draw(drawingArea);
+}
+
+void Ruler::setGlyphAtlasEnabled(bool enabled)
+{
+    glyphAtlasEnabled = enabled;
+    renderer.setGlyphAtlasEnabled(enabled);
+
+    // The labels in the tick cache have to be drawn again
+    endZoomTransition();
+    clearTickCache();
+    gtk_widget_queue_draw(drawingArea);
+}
+
+void Ruler::setTickPolicy(const RulerRenderer::TickPolicy &policy)
+{
+    renderer.setTickPolicy(policy);
+
+    // The interval and the ticks have to be chosen again. The prefetched layouts are
+    // divided by the old policy, so the prefetcher starts over with the new interval
+    const bool PREFETCHING = prefetcher != nullptr;
+    setPrefetching(false);
+    calculateTickIntervals();
+    setPrefetching(PREFETCHING);
+    endZoomTransition();
+    clearTickCache();
+    gtk_widget_queue_draw(drawingArea);
+}
+
+void Ruler::setWidgetFont(bool enabled)
+{
+    widgetFont = enabled;
+    if (!updateWidgetFont()) { return; }
+
+    // The labels in the tick cache have to be drawn again, and may need more room
+    calculateTickIntervals();
+    endZoomTransition();
+    clearTickCache();
+    gtk_widget_queue_draw(drawingArea);
+}
+
+void Ruler::setUpdateCoalescing(bool enabled)
+{
+    coalesceUpdates = enabled;
+
+    // Don't leave an update waiting for a frame that's no longer needed
+    if (!coalesceUpdates && updatePending) { resolveUpdate(); }
+}
+
+void Ruler::setZoomTransitions(bool enabled)
+{
+    zoomTransitions = enabled;
+
+    // Snap to the new interval if a transition is in progress
+    if (!zoomTransitions && zoomTransitionLayer != nullptr)
+    {
+        endZoomTransition();
+        gtk_widget_queue_draw(drawingArea);
+    }
+}
+
+void Ruler::setPrefetching(bool enabled)
+{
+    if (enabled == (prefetcher != nullptr)) { return; }
+
+    prefetched.reset();
+    if (!enabled)
+    {
+        // Stops the worker thread
+        prefetcher.reset();
+        return;
+    }
+
+    prefetcher = std::make_unique<TickPrefetcher>(
+      renderer.getTickPolicy().subdivision, renderer.getStyle().fontFamily, renderer.getStyle().fontSize);
+    prefetchNeighbours(false);
+}
+
+void Ruler::setTickCacheSharing(bool enabled)
+{
+    shareTickCache = enabled;
+}
+
+const Ruler::UpdateCounters &Ruler::getUpdateCounters() const
+{
+    return updateCounters;
+}
+
+void Ruler::resetUpdateCounters()
+{
+    updateCounters = UpdateCounters{};
+}
+
+Ruler::Stats Ruler::getStats() const
+{
+    Stats result = stats;
+    result.tickLayouts = renderer.getCounts().tickLayouts;
+    result.ticks = renderer.getCounts().ticks;
+    result.labels = renderer.getCounts().labels;
+    result.strokes = renderer.getCounts().strokes;
+    result.labelCacheHits = renderer.getLabelCacheStats().hits;
+    result.labelCacheMisses = renderer.getLabelCacheStats().misses;
+    if (prefetcher != nullptr)
+    {
+        result.prefetchHits = prefetcher->getStats().hits;
+        result.prefetchMisses = prefetcher->getStats().misses;
+    }
+    return result;
+}
+
+void Ruler::resetStats()
+{
+    stats = Stats{};
+    renderer.resetCounts();
+    if (prefetcher != nullptr) { prefetcher->resetStats(); }
+}
+
+void Ruler::requestUpdate()
+{
+    updateCounters.updates++;
+
+    if (!coalesceUpdates)
+    {
+        updatePending = true;
+        resolveUpdate();
+        return;
+    }
+
+    if (updatePending)
+    {
+        // The update that is already pending will pick up this change as well
+        updateCounters.collapsed++;
+        return;
+    }
+
+    updatePending = true;
+    if (tickCallbackId == 0)
+    {
+        tickCallbackId = gtk_widget_add_tick_callback(drawingArea, frameClockCallback, this, nullptr);
+    }
+}
+
+void Ruler::resolveUpdate()
+{
+    if (!updatePending) { return; }
+    updatePending = false;
+
+    calculateTickIntervals();
+
+    // We need to manually trigger the widget to redraw
+    invalidateChanges();
+}
+
+void Ruler::invalidateChanges()
+{
+    const double DRAW_AREA_SIZE = (orientation == HORIZONTAL) ? width : height;
+    const double SHIFT = pixelShift(shownLower, shownUpper, shownKey);
+    const bool SHOWED_TICKS = shownKey.majorInterval > 0;
+    shownLower = lowerLimit;
+    shownUpper = upperLimit;
+    shownKey = currentTickCacheKey();
+
+    // If the ticks end up exactly where they were last shown, nothing changes on screen
+    if (SHIFT == 0) { return; }
+
+    // The contents of a window of our own can be moved along with the ticks. A widget that isn't
+    // realized shows nothing yet, so the strips are only queued to mark what the next draw renders
+    GdkWindow *window = gtk_widget_get_has_window(drawingArea) ? gtk_widget_get_window(drawingArea) : nullptr;
+    if (!std::isnan(SHIFT) && zoomTransitionLayer == nullptr && (window != nullptr || !gtk_widget_get_realized(drawingArea)))
+    {
+        if (window != nullptr)
+        {
+            gdk_window_scroll(window, (orientation == HORIZONTAL) ? static_cast<int>(-SHIFT) : 0,
+                              (orientation == HORIZONTAL) ? 0 : static_cast<int>(-SHIFT));
+        }
+
+        // The strip that comes into view, and the ticks and labels that were clipped or skipped at the old edges,
+        // as in updateTickCache(). The side borders moved with the contents, so they are always redrawn
+        const double margin = majorTickSpacing + RulerRenderer::LABEL_OFFSET + RulerRenderer::LINE_WIDTH;
+        invalidateSpan(0, std::max(margin - SHIFT, 2 * RulerRenderer::LINE_WIDTH));
+        invalidateSpan(std::min(DRAW_AREA_SIZE - margin - SHIFT, DRAW_AREA_SIZE - 2 * RulerRenderer::LINE_WIDTH), DRAW_AREA_SIZE);
+        return;
+    }
+
+    // Otherwise every tick moves. The borders stay where they are, but the ticks and labels
+    // can be anywhere along a ruler with a valid interval, before or after the change
+    if (SHOWED_TICKS || majorInterval > 0) { invalidateSpan(0, DRAW_AREA_SIZE); }
+}
+
+void Ruler::invalidateSpan(double start, double end)
+{
+    const int START = static_cast<int>(floor(start));
+    const int LENGTH = static_cast<int>(ceil(end)) - START;
+    if (LENGTH <= 0) { return; }
+    updateCounters.queuedPixels += LENGTH;
+
+    if (orientation == HORIZONTAL)
+    {
+        gtk_widget_queue_draw_area(drawingArea, START, 0, LENGTH, height);
+    }
+    else
+    {
+        gtk_widget_queue_draw_area(drawingArea, 0, START, width, LENGTH);
+    }
+}
+
+double Ruler::markerPixelPosition() const
+{
+    if (std::isnan(markerPosition) || upperLimit <= lowerLimit) { return NAN; }
+
+    const double DRAW_AREA_SIZE = (orientation == HORIZONTAL) ? width : height;
+    return RulerCalculations::scaleToRange(markerPosition, lowerLimit, upperLimit, 0, DRAW_AREA_SIZE);
+}
+
+void Ruler::invalidateMarker(double pixelPosition)
+{
+    if (std::isnan(pixelPosition)) { return; }
+
+    // The marker is centered on the pixel a tick line at the same position would cover,
+    // and its anti-aliased edges may touch one more pixel on either side
+    const double CENTER = pixelPosition + RulerRenderer::LINE_WIDTH * RulerRenderer::LINE_COORD_OFFSET;
+    invalidateSpan(CENTER - RulerRenderer::MARKER_HALF_WIDTH - 1, CENTER + RulerRenderer::MARKER_HALF_WIDTH + 1);
+}
+
+gboolean Ruler::frameClockCallback(GtkWidget * /*widget*/, GdkFrameClock * /*frameClock*/, gpointer data)
+{
+    auto *ruler = static_cast<Ruler *>(data);
+
+    // Returning G_SOURCE_REMOVE removes the callback
+    ruler->tickCallbackId = 0;
+    ruler->resolveUpdate();
+
+    return G_SOURCE_REMOVE;
 }
 
 void Ruler::sizeAllocateCallback(GtkWidget *widget, GdkRectangle * /*allocation*/, gpointer data)
@@ -63,16 +389,76 @@ void Ruler::sizeAllocateCallback(GtkWidget *widget, GdkRectangle * /*allocation*
     ruler->width = gtk_widget_get_allocated_width(widget);
     ruler->height = gtk_widget_get_allocated_height(widget);
 
+    ruler->requestUpdate();
+}
+
+void Ruler::scaleFactorCallback(GtkWidget *widget, GParamSpec * /*pspec*/, gpointer data)
+{
+    auto *ruler = static_cast<Ruler *>(data);
+    ruler->setScaleFactor(gtk_widget_get_scale_factor(widget));
+}
+
+void Ruler::styleUpdatedCallback(GtkWidget *widget, gpointer data)
+{
+    auto *ruler = static_cast<Ruler *>(data);
+
+    // The style is updated for many reasons, most of which don't affect the font
+    if (!ruler->widgetFont || !ruler->updateWidgetFont()) { return; }
+
     ruler->calculateTickIntervals();
+    ruler->endZoomTransition();
+    ruler->clearTickCache();
+    gtk_widget_queue_draw(widget);
 }
 
 void Ruler::calculateTickIntervals()
 {
+    updateCounters.layouts++;
+
     const double ALLOCATED_SIZE = (orientation == HORIZONTAL) ? width : height;
+    const double PREVIOUS_INTERVAL = majorInterval;
     // Calculate the interval between major ruler ticks
-    majorInterval = RulerCalculations::calculateInterval(lowerLimit, upperLimit, ALLOCATED_SIZE);
+    majorInterval = renderer.majorInterval(lowerLimit, upperLimit, ALLOCATED_SIZE);
     // Calculate the spacing in pixels between major ruler ticks
     majorTickSpacing = RulerCalculations::intervalPixelSpacing(majorInterval, lowerLimit, upperLimit, ALLOCATED_SIZE);
+    labelDecimals = RulerCalculations::labelDecimals(majorInterval, lowerLimit, upperLimit);
+    labelSpace = (majorInterval > 0) ? renderer.labelSpace(lowerLimit, upperLimit, majorInterval, labelDecimals) : 0;
+
+    if (prefetcher != nullptr) { prefetchNeighbours(majorInterval != PREVIOUS_INTERVAL); }
+}
+
+TickPrefetcher::Key Ruler::currentLayoutKey() const
+{
+    const double DRAW_AREA_SIZE = (orientation == HORIZONTAL) ? width : height;
+    return TickPrefetcher::Key{lowerLimit, upperLimit, DRAW_AREA_SIZE, majorInterval, majorTickSpacing, currentGeometry().majorTickLength(), scaleFactor};
+}
+
+void Ruler::prefetchNeighbours(bool intervalChanged)
+{
+    // The worker may have precomputed the zoom level we just arrived at
+    if (intervalChanged) { prefetched = prefetcher->take(majorInterval); }
+
+    const double DRAW_AREA_SIZE = (orientation == HORIZONTAL) ? width : height;
+    if (upperLimit <= lowerLimit || DRAW_AREA_SIZE <= 0) { return; }
+
+    // Predict the ranges of the zoom levels around the center of the current range
+    const double CENTER = lowerLimit + (upperLimit - lowerLimit) / 2;
+    std::array<TickPrefetcher::Key, TickPrefetcher::NEIGHBOURS> keys{};
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        const double HALF_SIZE = ZOOM_FACTORS.at(i) * (upperLimit - lowerLimit) / 2;
+        const double LOWER = CENTER - HALF_SIZE;
+        const double UPPER = CENTER + HALF_SIZE;
+        const double INTERVAL = renderer.majorInterval(LOWER, UPPER, DRAW_AREA_SIZE);
+        const int SPACING = RulerCalculations::intervalPixelSpacing(INTERVAL, LOWER, UPPER, DRAW_AREA_SIZE);
+        keys.at(i) = TickPrefetcher::Key{LOWER, UPPER, DRAW_AREA_SIZE, INTERVAL, SPACING, currentGeometry().majorTickLength(), scaleFactor};
+    }
+    prefetcher->request(keys);
+}
+
+RulerRenderer::Geometry Ruler::currentGeometry() const
+{
+    return RulerRenderer::Geometry{orientation, lowerLimit, upperLimit, width, height, majorInterval, majorTickSpacing, labelDecimals};
 }
 
 gboolean Ruler::drawCallback(GtkWidget *widget, cairo_t *cr, gpointer data)
@@ -85,243 +471,446 @@ gboolean Ruler::drawCallback(GtkWidget *widget, cairo_t *cr, gpointer data)
 
 void Ruler::draw(GtkWidget *widget, cairo_t *cr)
 {
+    RULER_STAT(const auto drawStart = std::chrono::steady_clock::now());
+
+    // The frame clock normally resolves pending updates before drawing, but
+    // an update may still be pending if the widget is drawn outside a frame.
+    // The parts outside the clip region are drawn in the next frame
+    if (updatePending)
+    {
+        updatePending = false;
+        calculateTickIntervals();
+        invalidateChanges();
+    }
+
     // Draw background using widget's style context
     GtkStyleContext *context = gtk_widget_get_style_context(widget);
     gtk_render_background(context, cr, 0, 0, width, height);
 
     // Draw outline along left and right sides and along the bottom
-    gdk_cairo_set_source_rgba(cr, &lineColor);
-    cairo_set_line_width(cr, LINE_WIDTH);
-    // Cairo integer coordinates map to points halfway between pixels.
-    // We need to offset the coordinates by 0.5 times the line width
-    // to get clear lines
-    double drawOffset = LINE_WIDTH * LINE_COORD_OFFSET;
-    if (orientation == HORIZONTAL)
-    {
-        // Draw line along left side of ruler
-        cairo_move_to(cr, drawOffset, 0);
-        cairo_line_to(cr, drawOffset, height);
+    const RulerRenderer::Geometry GEOMETRY = currentGeometry();
+    renderer.drawBorders(cr, GEOMETRY);
 
-        // Draw line along right side of ruler
-        cairo_move_to(cr, width - drawOffset, 0);
-        cairo_line_to(cr, width - drawOffset, height);
-        // Render both lines
-        cairo_stroke(cr);
-
-        // Draw thicker border along bottom of ruler
-        cairo_set_line_width(cr, 2 * LINE_WIDTH);
-        drawOffset = 2 * LINE_WIDTH * LINE_COORD_OFFSET;
-        cairo_move_to(cr, 0, height - drawOffset);
-        cairo_line_to(cr, width, height - drawOffset);
-        cairo_stroke(cr);
-    }
-    else
+    // Draw the ticks and labels from the cache, unless the majorInterval is invalid
+    if (majorInterval > 0)
     {
-        // Draw line along top side of ruler
-        cairo_move_to(cr, 0, drawOffset);
-        cairo_line_to(cr, width, drawOffset);
-
-        // Draw line along bottom side of ruler
-        cairo_move_to(cr, 0, height - drawOffset);
-        cairo_line_to(cr, width, height - drawOffset);
-        // Render both lines
-        cairo_stroke(cr);
+        if (zoomTransitions) { updateZoomTransition(); }
 
-        // Draw thicker border along right of ruler
-        cairo_set_line_width(cr, 2 * LINE_WIDTH);
-        drawOffset = 2 * LINE_WIDTH * LINE_COORD_OFFSET;
-        cairo_move_to(cr, width - drawOffset, 0);
-        cairo_line_to(cr, width - drawOffset, height);
-        cairo_stroke(cr);
+        if (zoomTransitionLayer != nullptr)
+        {
+            drawZoomTransition(cr);
+        }
+        else
+        {
+            // Only the part of the ruler within the clip region has to be up-to-date
+            double clipX1{};
+            double clipY1{};
+            double clipX2{};
+            double clipY2{};
+            cairo_clip_extents(cr, &clipX1, &clipY1, &clipX2, &clipY2);
+            updateTickCache(orientation == HORIZONTAL ? clipX1 : clipY1, orientation == HORIZONTAL ? clipX2 : clipY2);
+            cairo_set_source_surface(cr, tickCache, 0, 0);
+            cairo_paint(cr);
+        }
     }
-    cairo_set_line_width(cr, Ruler::LINE_WIDTH);
 
-    // The majorInterval is invalid, don't attempt to draw anything else
-    if (majorInterval <= 0) { return; }
+    // The marker is drawn on top of the ticks, so moving it doesn't affect the tick cache
+    const double MARKER_PIXEL_POSITION = markerPixelPosition();
+    if (!std::isnan(MARKER_PIXEL_POSITION)) { renderer.drawMarker(cr, GEOMETRY, MARKER_PIXEL_POSITION); }
 
-    // Calculate the line length for the major ticks given the size of the ruler
-    double lineLength = (orientation == HORIZONTAL) ? MAJOR_TICK_LENGTH * height : MAJOR_TICK_LENGTH * width;
+#ifdef SCROOMRULER_STATS
+    const auto DRAW_TIME = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - drawStart);
+    stats.draws++;
+    stats.totalDrawTime += DRAW_TIME;
+    stats.maxDrawTime = std::max(stats.maxDrawTime, DRAW_TIME);
+#endif
+}
 
-    int firstTick = RulerCalculations::firstTick(lowerLimit, majorInterval);
+bool Ruler::TickCacheKey::operator==(const TickCacheKey &other) const
+{
+    return majorInterval == other.majorInterval && majorTickSpacing == other.majorTickSpacing && width == other.width
+           && height == other.height && scaleFactor == other.scaleFactor && orientation == other.orientation;
+}
+
+bool Ruler::TickCacheKey::operator!=(const TickCacheKey &other) const
+{
+    return !(*this == other);
+}
 
-    // Draw the range [0, upperLimit]
-    drawTicks(cr, firstTick, upperLimit, lineLength);
+Ruler::TickCacheKey Ruler::currentTickCacheKey() const
+{
+    return TickCacheKey{majorInterval, majorTickSpacing, width, height, scaleFactor, orientation};
 }
 
-void Ruler::drawTicks(cairo_t *cr, double lower, double upper, double lineLength)
+double Ruler::tickCacheShift() const
 {
-    // Position in ruler range
-    double pos = lower;
+    if (tickCache == nullptr) { return NAN; }
+    return pixelShift(tickCacheLower, tickCacheUpper, tickCacheKey);
+}
 
-    const double DRAW_AREA_ORIGIN = 0;
-    // We need to scale to either [0, width] or [0, height] depending
-    // on the orientation of the ruler
+double Ruler::pixelShift(double lower, double upper, const TickCacheKey &key) const
+{
     const double DRAW_AREA_SIZE = (orientation == HORIZONTAL) ? width : height;
+    const double RANGE_SIZE = upperLimit - lowerLimit;
+    const double OTHER_RANGE_SIZE = upper - lower;
 
-    // Move pos across range
-    while (pos < upper)
+    // The ticks can only be reused if nothing but the position of the range has changed
+    if (currentTickCacheKey() != key || std::abs(RANGE_SIZE - OTHER_RANGE_SIZE) > SCROLL_PIXEL_EPSILON * RANGE_SIZE / DRAW_AREA_SIZE)
     {
-        // Map pos from the ruler range to a drawing area position
-        double s = RulerCalculations::scaleToRange(pos, lowerLimit, upperLimit, DRAW_AREA_ORIGIN, DRAW_AREA_ORIGIN + DRAW_AREA_SIZE);
-        // Draw tick for this position
-        drawSingleTick(cr, s, lineLength, true, std::to_string(static_cast<int>(floor(pos))));
-
-        drawSubTicks(cr, s, s + majorTickSpacing, 0, LINE_MULTIPLIER * lineLength);
-        pos += majorInterval;
+        return NAN;
     }
+
+    // The contents can only be moved by whole pixels, and only if some of them stay visible
+    const double shift = (lowerLimit - lower) * DRAW_AREA_SIZE / RANGE_SIZE;
+    const double pixelShift = round(shift);
+    if (std::abs(shift - pixelShift) > SCROLL_PIXEL_EPSILON || std::abs(pixelShift) >= DRAW_AREA_SIZE) { return NAN; }
+
+    return pixelShift;
 }
 
-void Ruler::drawSingleTick(cairo_t *cr, double linePosition, double lineLength, bool drawLabel, const std::string &label)
+void Ruler::updateTickCache(double start, double end)
 {
+    const TickCacheKey key = currentTickCacheKey();
     const double DRAW_AREA_SIZE = (orientation == HORIZONTAL) ? width : height;
-    // Draw the line if is within the drawing area
-    if (0 < linePosition && linePosition < DRAW_AREA_SIZE)
-    {
-      // Draw line
-      cairo_set_line_width(cr, LINE_WIDTH);
-      // Offset the line to get a clear line
-      const double DRAW_OFFSET = LINE_WIDTH * LINE_COORD_OFFSET;
-      if(orientation == HORIZONTAL)
-      {
-        // Draw vertical line
-        cairo_move_to(cr, linePosition + DRAW_OFFSET, height);
-        cairo_line_to(cr, linePosition + DRAW_OFFSET, height - round(lineLength));
-      }
-      else
-      {
-        // Draw horizontal line
-        cairo_move_to(cr, width, linePosition + DRAW_OFFSET);
-        cairo_line_to(cr, width - round(lineLength), linePosition + DRAW_OFFSET);
-      }
-      cairo_stroke(cr);
-    }
-
-    // We'll be modifying the transformation matrix so
-    // we save the current one to restore later
-    cairo_save(cr);
-    if (drawLabel) // Draw the tick label
-    {
-        // Set text font and size
-        cairo_select_font_face(cr, "sans-serif", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-        cairo_set_font_size(cr, FONT_SIZE);
-        // Get the extents of the text if it were drawn
-        cairo_text_extents_t textExtents;
-        cairo_text_extents(cr, label.c_str(), &textExtents);
-        // Draw the label if there's enough room between the major ticks and at least part of the text is within the drawing area
-        if (textExtents.x_advance < majorTickSpacing && linePosition + textExtents.x_advance > 0 && linePosition < DRAW_AREA_SIZE)
+    const double CLIP_START = std::max(0.0, floor(start));
+    const double CLIP_END = std::min(DRAW_AREA_SIZE, ceil(end));
+
+    const double pixelShift = tickCacheShift();
+
+    if (tickCache == nullptr || key != tickCacheKey)
+    {
+        clearTickCache();
+        if (!adoptSharedTickCache())
         {
-            if (orientation == HORIZONTAL)
-            {
-                // Center the text on the line
-                cairo_move_to(cr, linePosition + LABEL_OFFSET, height - LABEL_ALIGN * lineLength - LINE_MULTIPLIER * textExtents.y_bearing);
-                cairo_show_text(cr, label.c_str());
-            }
-            else
+            tickCache = createTickCacheSurface();
+            tickCacheValidStart = 0;
+            tickCacheValidEnd = 0;
+        }
+    }
+    else if (std::isnan(pixelShift))
+    {
+        // The contents of the cache can't be reused. A shared cache must not be drawn to, so we start on a new one
+        if (!adoptSharedTickCache())
+        {
+            if (tickCacheShared)
             {
-                cairo_move_to(cr, width - LABEL_ALIGN * lineLength - LINE_MULTIPLIER * textExtents.y_bearing, linePosition - LABEL_OFFSET);
-                cairo_rotate(cr, -M_PI / 2);
-                cairo_show_text(cr, label.c_str());
+                clearTickCache();
+                tickCache = createTickCacheSurface();
             }
+            tickCacheValidStart = 0;
+            tickCacheValidEnd = 0;
         }
     }
-    cairo_restore(cr);
+    else if (pixelShift != 0)
+    {
+        if (tickCacheBack == nullptr) { tickCacheBack = createTickCacheSurface(); }
+
+        // Copy the cache at an offset. The SOURCE operator clears the part not covered by the old cache.
+        cairo_t *copy = cairo_create(tickCacheBack);
+        cairo_set_operator(copy, CAIRO_OPERATOR_SOURCE);
+        if (orientation == HORIZONTAL)
+        {
+            cairo_set_source_surface(copy, tickCache, -pixelShift, 0);
+        }
+        else
+        {
+            cairo_set_source_surface(copy, tickCache, 0, -pixelShift);
+        }
+        cairo_paint(copy);
+        cairo_destroy(copy);
+
+        std::swap(tickCache, tickCacheBack);
+
+        // The copy is our own. A shared cache must not be drawn to, so it isn't kept for the next pan
+        if (tickCacheShared)
+        {
+            cairo_surface_destroy(tickCacheBack);
+            tickCacheBack = nullptr;
+            tickCacheShared = false;
+        }
+
+        // Ticks and labels close to the old edges of the ruler may have been clipped or skipped
+        // while rendering, so the part within one major tick spacing of them is no longer valid
+        const double margin = majorTickSpacing + RulerRenderer::LABEL_OFFSET + RulerRenderer::LINE_WIDTH;
+        double validStart = tickCacheValidStart - pixelShift;
+        double validEnd = tickCacheValidEnd - pixelShift;
+        if (tickCacheValidStart < margin) { validStart = std::max(validStart, margin - pixelShift); }
+        if (tickCacheValidEnd > DRAW_AREA_SIZE - margin) { validEnd = std::min(validEnd, DRAW_AREA_SIZE - margin - pixelShift); }
+        tickCacheValidStart = std::max(0.0, validStart);
+        tickCacheValidEnd = std::min(DRAW_AREA_SIZE, validEnd);
+        if (tickCacheValidEnd <= tickCacheValidStart)
+        {
+            tickCacheValidStart = 0;
+            tickCacheValidEnd = 0;
+        }
+    }
+
+    tickCacheKey   = key;
+    tickCacheLower = lowerLimit;
+    tickCacheUpper = upperLimit;
+
+    // Render the parts of the clip region that aren't valid yet
+    if (CLIP_END <= CLIP_START) { return; }
+    const bool EMPTY = tickCacheValidEnd <= tickCacheValidStart;
+    if (!EMPTY && CLIP_START >= tickCacheValidStart && CLIP_END <= tickCacheValidEnd) { return; }
+
+    cairo_t *cacheCr = cairo_create(tickCache);
+    if (EMPTY || CLIP_END < tickCacheValidStart || CLIP_START > tickCacheValidEnd)
+    {
+        // The valid part of the cache has to stay contiguous, so if the clip
+        // region doesn't touch it, we start over with just the clip region
+        renderTickStrip(cacheCr, CLIP_START, CLIP_END);
+        tickCacheValidStart = CLIP_START;
+        tickCacheValidEnd = CLIP_END;
+    }
+    else
+    {
+        if (CLIP_START < tickCacheValidStart)
+        {
+            renderTickStrip(cacheCr, CLIP_START, tickCacheValidStart);
+            tickCacheValidStart = CLIP_START;
+        }
+        if (CLIP_END > tickCacheValidEnd)
+        {
+            renderTickStrip(cacheCr, tickCacheValidEnd, CLIP_END);
+            tickCacheValidEnd = CLIP_END;
+        }
+    }
+    cairo_destroy(cacheCr);
+
+    // Once the ticks are rendered over the full length of the ruler, identical rulers can draw from them
+    if (shareTickCache && !tickCacheShared && tickCacheValidStart <= 0 && tickCacheValidEnd >= DRAW_AREA_SIZE)
+    {
+        tickCacheShared = SharedTickCache::instance().insert(sharedTickCacheKey(), tickCache);
+    }
 }
 
-void Ruler::drawSubTicks(cairo_t *cr, double lower, double upper, int depth, double lineLength)
+SharedTickCache::Key Ruler::sharedTickCacheKey() const
 {
-    // We don't need to divide the segment any further so return
-    if (static_cast<unsigned int>(depth) >= SUBTICK_SEGMENTS.size()) { return; }
+    const RulerRenderer::Style &style = renderer.getStyle();
+    // The description of the widget's font includes its size
+    const std::string &fontFamily = widgetFont ? widgetFontName : style.fontFamily;
+    const double fontSize = widgetFont ? 0 : style.fontSize;
+    return SharedTickCache::Key{lowerLimit,
+                                upperLimit,
+                                width,
+                                height,
+                                orientation,
+                                scaleFactor,
+                                fontFamily,
+                                fontSize,
+                                style.lineColor,
+                                glyphAtlasEnabled,
+                                renderer.getTickPolicy().calculateInterval};
+}
 
-    int numSegments = SUBTICK_SEGMENTS.at(depth);
-    double interval = abs(upper - lower) / numSegments;
+bool Ruler::adoptSharedTickCache()
+{
+    if (!shareTickCache) { return false; }
+
+    cairo_surface_t *shared = SharedTickCache::instance().lookup(sharedTickCacheKey());
+    if (shared == nullptr) { return false; }
+
+    if (tickCache != nullptr) { cairo_surface_destroy(tickCache); }
+    tickCache = shared;
+    tickCacheShared = true;
+    tickCacheValidStart = 0;
+    tickCacheValidEnd = (orientation == HORIZONTAL) ? width : height;
+    RULER_STAT(stats.sharedTickCacheHits++);
+    return true;
+}
 
-    if (interval < MIN_SPACE_SUBTICKS) { return; }
+bool Ruler::updateWidgetFont()
+{
+    PangoContext *context = widgetFont ? gtk_widget_get_pango_context(drawingArea) : nullptr;
+    if (!renderer.setPangoContext(context)) { return false; }
 
-    // We draw from lower->upper / upper->lower, but in the process, we might be exceeding
-    // the ruler area, so we also check that we're still inside the drawing area
-    const double DRAW_AREA_SIZE = (orientation == HORIZONTAL) ? width : height;
-    const double limit = DRAW_AREA_SIZE;
+    widgetFontName.clear();
+    if (context != nullptr)
+    {
+        gchar *name = pango_font_description_to_string(pango_context_get_font_description(context));
+        widgetFontName = name;
+        g_free(name);
+    }
+    return true;
+}
 
-    // Position along the ruler to draw tick at
-    double tick = 0;
-    double pos = lower;
+void Ruler::renderTickStrip(cairo_t *cr, double start, double end)
+{
+    cairo_save(cr);
 
-    // Draw at most (numSegments - 1) ticks, while not exceeding the limit
-    while (tick < numSegments && pos < limit)
+    // Restrict drawing to the strip
+    if (orientation == HORIZONTAL)
+    {
+        cairo_rectangle(cr, start, 0, end - start, height);
+    }
+    else
     {
-        // We don't want to draw the tick for tick == 0, because
-        // we would end up drawing over other ticks
-        if (tick != 0)
+        cairo_rectangle(cr, 0, start, width, end - start);
+    }
+    cairo_clip(cr);
+
+    // Clear the strip
+    cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+    cairo_paint(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+
+    // Use the label extents and tick layout the prefetcher computed for this zoom level, if any.
+    // The extents are handed to the label cache once, the layout only fits the predicted range
+    const RulerRenderer::Geometry GEOMETRY = currentGeometry();
+    const TickLayout *layout = nullptr;
+    if (prefetched != nullptr)
+    {
+        if (prefetched->key.scaleFactor == scaleFactor)
         {
-            drawSingleTick(cr, pos, lineLength, false, "");
+            // The labels are rendered at the same device resolution as the tick cache
+            LabelCache &labelCache = renderer.labelCacheFor(cr);
+            for (size_t i = 0; i < prefetched->labels.size(); i++)
+            {
+                labelCache.insertExtents(prefetched->labels[i].data(), prefetched->labelExtents[i]);
+            }
         }
-        tick++;
-        // Draw ticks at level below
-        drawSubTicks(cr, pos, pos + interval, depth + 1, LINE_MULTIPLIER * lineLength);
+        prefetched->labels.clear();
+        prefetched->labelExtents.clear();
 
-        pos += interval;
+        if (prefetched->key == currentLayoutKey()) { layout = &prefetched->layout; }
     }
+
+    if (layout != nullptr)
+    {
+        renderer.drawTicks(cr, GEOMETRY, *layout);
+    }
+    else
+    {
+        // Only lay out the ticks that are visible in the strip
+        renderer.drawTicks(cr, GEOMETRY, start, end);
+    }
+
+    cairo_restore(cr);
 }
 
-double RulerCalculations::scaleToRange(double x, double src_lower, double src_upper, double dest_lower, double dest_upper)
+cairo_surface_t *Ruler::createTickCacheSurface() const
 {
-    double src_size = src_upper - src_lower;
-    double dest_size = dest_upper - dest_lower;
-    double scale = dest_size / src_size;
+    GdkWindow *window = gtk_widget_get_window(drawingArea);
+    if (window != nullptr)
+    {
+        return gdk_window_create_similar_image_surface(window, CAIRO_FORMAT_ARGB32, width, height, scaleFactor);
+    }
 
-    return dest_lower + round(scale * (x - src_lower));
+    // The drawing area has no window when it is drawn offscreen, so we set the device scale ourselves
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width * scaleFactor, height * scaleFactor);
+    cairo_surface_set_device_scale(surface, scaleFactor, scaleFactor);
+    return surface;
 }
 
-int RulerCalculations::calculateInterval(double lower, double upper, double allocatedSize)
+void Ruler::updateZoomTransition()
 {
-    // We need to calculate the distance between the largest ticks on the ruler
-    // We will try each interval x * 10^n for x in VALID_INTERVALS and integer n >= 0
-    // from smallest to largest until we find an interval which will produce a
-    // spacing of a large enough width/height when drawn
+    const TickCacheKey key = currentTickCacheKey();
+    const double DRAW_AREA_SIZE = (orientation == HORIZONTAL) ? width : height;
+
+    // The layers can only be scaled along the ruler, so any other change ends the transition
+    const bool SAME_DIMENSIONS = key.width == tickCacheKey.width && key.height == tickCacheKey.height
+                                 && key.scaleFactor == tickCacheKey.scaleFactor && key.orientation == tickCacheKey.orientation;
+    if (zoomTransitionLayer != nullptr
+        && (!SAME_DIMENSIONS || std::chrono::steady_clock::now() - zoomTransitionStart >= ZOOM_TRANSITION_DURATION))
+    {
+        endZoomTransition();
+    }
 
-    if (upper <= lower) { return -1; }
+    // A transition starts from a tick cache that covers the full length of the ruler
+    if (tickCache == nullptr || !SAME_DIMENSIONS || key.majorInterval == tickCacheKey.majorInterval
+        || tickCacheValidStart > 0 || tickCacheValidEnd < DRAW_AREA_SIZE)
+    {
+        return;
+    }
 
-    // Index in the ruler's VALID_INTERVALS array
-    int intervalIndex = 0;
-    // Each interval is multiplied by 10 raised to a power n
-    const int INTERVAL_BASE = 10;
-    int intervalN = 0;
+    // If the interval changes again during a transition, we fade from the ticks that were fading in
+    if (zoomTransitionLayer != nullptr) { cairo_surface_destroy(zoomTransitionLayer); }
+    zoomTransitionLayer = tickCache;
+    zoomTransitionLower = tickCacheLower;
+    zoomTransitionUpper = tickCacheUpper;
+    tickCache = nullptr;
+    tickCacheShared = false;
+    zoomTransitionStart = std::chrono::steady_clock::now();
+    RULER_STAT(stats.zoomTransitions++);
 
-    // The interval to be returned
-    int interval = 1;
+    // The ticks of the new interval are rendered once, and scaled for the rest of the transition
+    updateTickCache(0, DRAW_AREA_SIZE);
 
-    while (true)
+    if (zoomTransitionCallbackId == 0)
     {
-        interval = floor(VALID_INTERVALS.at(intervalIndex) * pow(INTERVAL_BASE, intervalN));
+        zoomTransitionCallbackId = gtk_widget_add_tick_callback(drawingArea, zoomTransitionCallback, this, nullptr);
+    }
+}
 
-        // Calculate the drawn size for this interval by mapping from the ruler range
-        // to the ruler size on the screen
-        double spacing = intervalPixelSpacing(interval, lower, upper, allocatedSize);
-        // If we've found a segment of appropriate size, we can stop
-        if (spacing >= MIN_SPACE_MAJORTICKS) { break; }
+void Ruler::drawZoomTransition(cairo_t *cr)
+{
+    const double ELAPSED = std::chrono::duration<double>(std::chrono::steady_clock::now() - zoomTransitionStart).count();
+    const double PROGRESS = std::clamp(ELAPSED / std::chrono::duration<double>(ZOOM_TRANSITION_DURATION).count(), 0.0, 1.0);
 
-        // Otherwise, try the next interval
-        intervalIndex++;
-        if (intervalIndex == VALID_INTERVALS.size())
-        {
-            // We tried all intervals for the current n, increment n
-            intervalIndex = 0;
-            intervalN++;
-        }
+    paintScaledLayer(cr, zoomTransitionLayer, zoomTransitionLower, zoomTransitionUpper, 1 - PROGRESS);
+    paintScaledLayer(cr, tickCache, tickCacheLower, tickCacheUpper, PROGRESS);
+}
+
+void Ruler::paintScaledLayer(cairo_t *cr, cairo_surface_t *layer, double layerLower, double layerUpper, double alpha) const
+{
+    const double DRAW_AREA_SIZE = (orientation == HORIZONTAL) ? width : height;
+
+    // Map the range of the layer onto the current range along the ruler
+    const double SCALE = (layerUpper - layerLower) / (upperLimit - lowerLimit);
+    const double OFFSET = (layerLower - lowerLimit) * DRAW_AREA_SIZE / (upperLimit - lowerLimit);
+
+    cairo_save(cr);
+    if (orientation == HORIZONTAL)
+    {
+        cairo_translate(cr, OFFSET, 0);
+        cairo_scale(cr, SCALE, 1);
+    }
+    else
+    {
+        cairo_translate(cr, 0, OFFSET);
+        cairo_scale(cr, 1, SCALE);
     }
+    cairo_set_source_surface(cr, layer, 0, 0);
+    cairo_paint_with_alpha(cr, alpha);
+    cairo_restore(cr);
+}
 
-    return interval;
+void Ruler::endZoomTransition()
+{
+    if (zoomTransitionLayer != nullptr)
+    {
+        cairo_surface_destroy(zoomTransitionLayer);
+        zoomTransitionLayer = nullptr;
+    }
 }
 
-int RulerCalculations::intervalPixelSpacing(double interval, double lower, double upper, double allocatedSize)
+gboolean Ruler::zoomTransitionCallback(GtkWidget *widget, GdkFrameClock * /*frameClock*/, gpointer data)
 {
-    if (upper <= lower) { return -1; }
+    auto *ruler = static_cast<Ruler *>(data);
+
+    // The draw that sees the transition is done ends it, after which the callback is no longer needed
+    if (ruler->zoomTransitionLayer == nullptr)
+    {
+        ruler->zoomTransitionCallbackId = 0;
+        return G_SOURCE_REMOVE;
+    }
 
-    const double RANGE_SIZE = upper - lower;
-    return static_cast<int>(round((allocatedSize / RANGE_SIZE) * interval));
+    gtk_widget_queue_draw(widget);
+    return G_SOURCE_CONTINUE;
 }
 
-int RulerCalculations::firstTick(double lower, int interval)
+void Ruler::clearTickCache()
 {
-    return static_cast<int>(floor(lower / interval)) * interval;
+    tickCacheShared = false;
+    if (tickCache != nullptr)
+    {
+        cairo_surface_destroy(tickCache);
+        tickCache = nullptr;
+    }
+    if (tickCacheBack != nullptr)
+    {
+        cairo_surface_destroy(tickCacheBack);
+        tickCacheBack = nullptr;
+    }
 }
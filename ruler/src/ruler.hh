@@ -1,12 +1,24 @@
 #pragma once
 
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+
 #include <gtk/gtk.h>
 #include <boost/shared_ptr.hpp>
 
+#include "rulercalculations.hh"
+#include "rulerrenderer.hh"
+#include "sharedtickcache.hh"
+#include "tickprefetcher.hh"
+
 /**
  * This class draws a ruler to a GtkDrawingArea.
  * It is intended as a replacement for the old GTK2 ruler widget and is written
  * to mimic that widget's behavior as close as possible.
+ * The drawing itself is done by a RulerRenderer, which can also be used without a widget.
  */
 class Ruler
 {
@@ -14,11 +26,75 @@ class Ruler
 public:
     using Ptr = boost::shared_ptr<Ruler>;
 
-    enum Orientation
+    /** Counts of the updates to the range and size of a ruler. */
+    struct UpdateCounters
     {
-        HORIZONTAL, VERTICAL
+        /** The number of times the range was set or a size was allocated. */
+        uint64_t updates{};
+
+        /** The number of times the tick intervals were calculated. */
+        uint64_t layouts{};
+
+        /** The number of updates that were collapsed into the layout of a later update in the same frame. */
+        uint64_t collapsed{};
+
+        /** The number of times the range was scrolled without calculating the tick intervals again. */
+        uint64_t scrolls{};
+
+        /** The total length along the ruler of the areas queued for redrawing, in pixels. Overlaps are counted twice. */
+        uint64_t queuedPixels{};
     };
 
+    /** Statistics of the drawing of a ruler. Only collected if SCROOMRULER_STATS is defined. */
+    struct Stats
+    {
+        /** The number of times the ruler was drawn. */
+        uint64_t draws{};
+
+        /** The number of times the ticks of a strip of the ruler were laid out. */
+        uint64_t tickLayouts{};
+
+        /** The number of tick lines drawn. */
+        uint64_t ticks{};
+
+        /** The number of tick labels drawn. */
+        uint64_t labels{};
+
+        /** The number of times a path was stroked. */
+        uint64_t strokes{};
+
+        /** The number of labels drawn from a pre-rendered surface of the label cache. */
+        uint64_t labelCacheHits{};
+
+        /** The number of labels the label cache had to render first. */
+        uint64_t labelCacheMisses{};
+
+        /** The number of times the interval changed to one whose layout was precomputed. */
+        uint64_t prefetchHits{};
+
+        /** The number of times the interval changed to one whose layout wasn't precomputed. */
+        uint64_t prefetchMisses{};
+
+        /** The number of times the rendered ticks were taken from the shared tick cache. */
+        uint64_t sharedTickCacheHits{};
+
+        /** The number of cross-fades between the ticks of two intervals that were started. */
+        uint64_t zoomTransitions{};
+
+        /** The time spent drawing the ruler. */
+        std::chrono::nanoseconds totalDrawTime{};
+
+        /** The longest time spent drawing the ruler once. */
+        std::chrono::nanoseconds maxDrawTime{};
+    };
+
+    using Orientation = RulerRenderer::Orientation;
+    static constexpr Orientation HORIZONTAL{RulerRenderer::HORIZONTAL};
+    static constexpr Orientation VERTICAL{RulerRenderer::VERTICAL};
+
+    /** The time it takes to cross-fade from the ticks of one interval to those of the next. */
+    static constexpr std::chrono::milliseconds ZOOM_TRANSITION_DURATION{150};
+
     /**
      * Creates a ruler.
      * @param orientation The orientation of the ruler.
@@ -40,6 +116,17 @@ public:
      */
     void setRange(double lower, double upper);
 
+    /**
+     * Moves the range of the ruler, keeping its size. Unlike setRange(), this doesn't calculate the interval
+     * of the ticks again, unless the labels at the new ends of the range need a different amount of space
+     * than those at the old ends. Only those two labels are formatted to find out. The rendered ticks
+     * are copied at a pixel offset, and only the ticks that come into view are laid out and drawn.
+     * The ruler is only drawn moved by whole pixels. Less than a pixel is carried over to the next scroll,
+     * but is included in getLowerLimit() and getUpperLimit() straight away.
+     * @param delta The distance to move the range by, in ruler units.
+     */
+    void scrollBy(double delta);
+
     /**
      * Returns the current lower limit of the ruler's range.
      * @return The current lower limit of the ruler's range.
@@ -52,6 +139,123 @@ public:
      */
     [[nodiscard]] double getUpperLimit() const;
 
+    /**
+     * Sets the position of the marker, a small triangle that points at a position in the ruler range,
+     * such as the position of the pointer on the canvas. The marker is drawn on top of the cached ticks,
+     * so moving it only redraws the parts of the ruler covered by its old and new position.
+     * @param position The position of the marker in the ruler range, or NAN to hide the marker.
+     */
+    void setMarkerPosition(double position);
+
+    /**
+     * Returns the position of the marker in the ruler range.
+     * @return The position of the marker in the ruler range, or NAN if the marker is hidden.
+     */
+    [[nodiscard]] double getMarkerPosition() const;
+
+    /**
+     * Enables or disables caching of the tick labels. Enabled by default.
+     * @param enabled True to draw labels from the cache, false to render every label with Cairo directly.
+     */
+    void setLabelCacheEnabled(bool enabled);
+
+    /**
+     * Enables or disables composing numeric tick labels from a glyph atlas. Disabled by default.
+     * The atlas renders every digit once, so new labels are drawn without shaping any text,
+     * but the labels can differ slightly from labels rendered by Cairo directly.
+     * Only has an effect while the label cache is enabled.
+     * @param enabled True to compose numeric labels from the glyph atlas.
+     */
+    void setGlyphAtlasEnabled(bool enabled);
+
+    /**
+     * Sets the tick policy the ruler is drawn with. DecimalTicks by default.
+     * @param policy The tick policy, such as RulerRenderer::TickPolicy::of<MetricTicks>().
+     */
+    void setTickPolicy(const RulerRenderer::TickPolicy &policy);
+
+    /**
+     * Enables or disables drawing the tick labels in the font of the drawing area widget. Disabled by default.
+     * When enabled, labels are laid out with Pango in the widget's Pango context, which follows the font set
+     * through CSS and the GTK settings, and laid out again when the style of the widget changes.
+     * When disabled, labels are drawn in the font family and size of the ruler's style.
+     * @param enabled True to draw the labels in the font of the widget.
+     */
+    void setWidgetFont(bool enabled);
+
+    /**
+     * Enables or disables coalescing of updates. Disabled by default.
+     * When enabled, changes to the range and size of the ruler are only recorded, and
+     * resolved once per frame in the update phase of the widget's frame clock.
+     * @param enabled True to coalesce updates, false to resolve every update immediately.
+     */
+    void setUpdateCoalescing(bool enabled);
+
+    /**
+     * Enables or disables zoom transitions. Disabled by default.
+     * When enabled, a change of the interval between major ticks doesn't snap to the new ticks, but
+     * cross-fades from the ticks of the old interval to those of the new one over ZOOM_TRANSITION_DURATION.
+     * Both sets of ticks are drawn from cached surfaces, which are scaled to the range while zooming,
+     * so the ticks are only rendered once per interval. They are rendered sharp when the transition ends.
+     * @param enabled True to cross-fade between intervals, false to switch immediately.
+     */
+    void setZoomTransitions(bool enabled);
+
+    /**
+     * Enables or disables precomputing the zoom levels next to the current one. Disabled by default.
+     * When enabled, a worker thread lays out the ticks and measures the labels of the ranges that are
+     * half and twice the size of the current one, around the same center, as Scroom zooms in steps
+     * of 2. When the interval changes to one of them, the ruler uses the precomputed label extents,
+     * and the precomputed tick layout if the range is the predicted one.
+     * @param enabled True to precompute the neighbouring zoom levels.
+     */
+    void setPrefetching(bool enabled);
+
+    /**
+     * Enables or disables sharing the rendered ticks with other rulers through the SharedTickCache. Disabled by default.
+     * When enabled, a ruler that has to render its ticks from scratch first looks for the ticks of an identical ruler
+     * in the cache, and adds its own once they are rendered over the full length of the ruler.
+     * @param enabled True to share the rendered ticks with other rulers.
+     */
+    void setTickCacheSharing(bool enabled);
+
+    /**
+     * Sets the number of device pixels per logical pixel the ruler is drawn at. Follows the scale factor of
+     * the drawing area widget by default, and again from the next time the scale factor of the widget changes.
+     * Used to draw to surfaces of another device scale than the widget's, such as when printing.
+     * @param newScaleFactor The number of device pixels per logical pixel. Must be positive.
+     */
+    void setScaleFactor(int newScaleFactor);
+
+    /**
+     * Returns the surface the rendered ticks are cached on, at the device resolution of the ruler.
+     * @return The surface of the tick cache, or null if the ticks haven't been rendered since the cache was cleared.
+     */
+    [[nodiscard]] cairo_surface_t *getTickCache() const;
+
+    /**
+     * Returns the counts of the updates to the range and size of the ruler.
+     * @return The counts of the updates to the range and size of the ruler.
+     */
+    [[nodiscard]] const UpdateCounters &getUpdateCounters() const;
+
+    /**
+     * Resets the counts of the updates to the range and size of the ruler to zero.
+     */
+    void resetUpdateCounters();
+
+    /**
+     * Returns the statistics of the drawing of the ruler since it was created or the statistics were reset.
+     * All statistics are zero unless SCROOMRULER_STATS is defined.
+     * @return The statistics of the drawing of the ruler.
+     */
+    [[nodiscard]] Stats getStats() const;
+
+    /**
+     * Resets the statistics of the drawing of the ruler to zero.
+     */
+    void resetStats();
+
 private:
 
     GtkWidget *drawingArea{};
@@ -59,59 +263,168 @@ private:
     static constexpr double DEFAULT_LOWER{0};
     static constexpr double DEFAULT_UPPER{10};
 
-    /**
-     * Each space between major ticks is split into 5 smaller segments and
-     * those segments are split into 2. (Assuming there's enough space.)
-     */
-    constexpr static std::array<int, 2> SUBTICK_SEGMENTS{
-            5, 2
-    };
-
     Orientation orientation;
 
     // The range to be displayed.
     double lowerLimit{DEFAULT_LOWER};
     double upperLimit{DEFAULT_UPPER};
 
+    /** The distance scrolled by scrollBy() that is less than a pixel and not drawn yet, in ruler units. */
+    double scrollRemainder{};
+
     // The allocated width and height for the drawing area widget.
     int width{};
     int height{};
 
+    /** The number of device pixels per logical pixel of the drawing area widget. */
+    int scaleFactor{1};
+
     /** The chosen interval between major ticks. */
-    int majorInterval{1};
+    double majorInterval{1};
 
     /** The space between major ticks when drawn. */
     int majorTickSpacing{};
 
-    // ==== DRAWING PROPERTIES ====
+    /** The number of decimals of the labels for majorInterval. */
+    int labelDecimals{};
+
+    /** The space the longest label of the range needed when majorInterval was chosen, see RulerRenderer::labelSpace(). */
+    double labelSpace{};
+
+    // ==== UPDATE COALESCING ====
+
+    /** True if updates are resolved once per frame instead of immediately. */
+    bool coalesceUpdates{false};
+
+    /** True if the range or size has changed since the tick intervals were last calculated. */
+    bool updatePending{false};
+
+    /** ID of the tick callback that resolves pending updates, or 0 if none is registered. */
+    guint tickCallbackId{};
+
+    UpdateCounters updateCounters;
+
+    /** The statistics of the drawing of the ruler, apart from those of the renderer. */
+    Stats stats;
+
+    // ==== DRAWING ====
+
+    /** Draws the borders, ticks, labels and marker, and caches the labels and tick layout. */
+    RulerRenderer renderer;
+
+    // ==== MARKER ====
+
+    /** The position of the marker in the ruler range, or NAN if the marker is hidden. */
+    double markerPosition{NAN};
+
+    // ==== ZOOM TRANSITIONS ====
+
+    /** True if changes of the interval are cross-faded. */
+    bool zoomTransitions{false};
+
+    /** The tick cache of the interval that is faded out, or null if no transition is in progress. */
+    cairo_surface_t *zoomTransitionLayer{};
+
+    // The range the layer that is faded out was rendered for.
+    double zoomTransitionLower{};
+    double zoomTransitionUpper{};
+
+    /** The time the transition started. */
+    std::chrono::steady_clock::time_point zoomTransitionStart;
+
+    /** ID of the tick callback that redraws the ruler during a transition, or 0 if none is registered. */
+    guint zoomTransitionCallbackId{};
+
+    // ==== TICK CACHE ====
 
     /**
-     * Cairo integer coordinates map to points halfway between pixels.
-     * Therefore, if we offset coordinates by 0.5 in the appropriate
-     * direction, we can draw clear lines.
+     * The ticks and labels are rendered to an offscreen surface, which is reused as
+     * long as the properties below are unchanged. On a pure pan the surface is
+     * copied at a pixel offset and only the newly exposed strip is rendered.
      */
-    static constexpr double LINE_COORD_OFFSET{0.5};
+    struct TickCacheKey
+    {
+        double majorInterval{};
+        int    majorTickSpacing{};
+        int    width{};
+        int    height{};
+        int    scaleFactor{1};
+        Orientation orientation{HORIZONTAL};
+
+        bool operator==(const TickCacheKey &other) const;
+        bool operator!=(const TickCacheKey &other) const;
+    };
+
+    /** The maximum distance in pixels from a whole pixel for a pan to be reused by copying. */
+    static constexpr double SCROLL_PIXEL_EPSILON{1e-6};
+
+    /** Surface containing the rendered ticks and labels. */
+    cairo_surface_t *tickCache{};
+
+    /** Surface the tick cache is copied into when scrolling. Swapped with tickCache afterwards. */
+    cairo_surface_t *tickCacheBack{};
+
+    TickCacheKey tickCacheKey{};
 
-    /** The minimum space between sub-ticks. */
-    static constexpr int MIN_SPACE_SUBTICKS{5};
+    // The range the tick cache was rendered for.
+    double tickCacheLower{};
+    double tickCacheUpper{};
 
-    static constexpr double FONT_SIZE{11};
+    // The part of the tick cache along the ruler in pixels that is up-to-date.
+    // Only the parts that have been drawn to the widget are rendered.
+    double tickCacheValidStart{};
+    double tickCacheValidEnd{};
 
-    /** Offset of tick label from the tick line in pixels. */
-    static constexpr double LABEL_OFFSET{4};
+    // The range and tick cache key the widget shows once the queued redraws are done.
+    // A pan from there only has to redraw the strip it brings into view.
+    double       shownLower{};
+    double       shownUpper{};
+    TickCacheKey shownKey{};
 
-    /** Alignment of tick label along the tick line as a fraction of line height. */
-    static constexpr double LABEL_ALIGN{0.7};
+    /** True if the rendered ticks are looked up in and added to the shared tick cache. */
+    bool shareTickCache{false};
 
-    /** The length of a tick one "level" down, as a fraction of the line length of the ticks one level up. */
-    static constexpr double LINE_MULTIPLIER{0.6};
+    /** True if the tick cache is in the shared tick cache, in which case it must not be drawn to. */
+    bool tickCacheShared{false};
 
-    GdkRGBA lineColor{0, 0, 0, 1};
+    /** True if numeric labels are composed from a glyph atlas. Part of the key of the shared tick cache. */
+    bool glyphAtlasEnabled{false};
 
-    static constexpr double LINE_WIDTH{1};
+    /** True if labels are drawn in the font of the widget. */
+    bool widgetFont{false};
 
-    /** Length of the major tick lines as a fraction of the width/height. */
-    static constexpr double MAJOR_TICK_LENGTH{0.8};
+    /** Description of the font of the widget the labels are drawn in, if widgetFont. Part of the key of the shared tick cache. */
+    std::string widgetFontName;
+
+    // ==== PREFETCHING ====
+
+    /** The factors the size of the range is multiplied by to predict the neighbouring zoom levels. */
+    static constexpr std::array<double, TickPrefetcher::NEIGHBOURS> ZOOM_FACTORS{0.5, 2};
+
+    /** Precomputes the neighbouring zoom levels if prefetching is enabled, null otherwise. */
+    std::unique_ptr<TickPrefetcher> prefetcher;
+
+    /** The precomputed layout of the current interval, if there is one. */
+    std::unique_ptr<TickPrefetcher::Result> prefetched;
+
+    /**
+     * Returns the key of the tick layout for the current range and dimensions.
+     * @return The key of the tick layout for the current range and dimensions.
+     */
+    [[nodiscard]] TickPrefetcher::Key currentLayoutKey() const;
+
+    /**
+     * Picks up the precomputed layout of a new interval, and asks the prefetcher to
+     * precompute the zoom levels next to the current one.
+     * @param intervalChanged True if the interval between major ticks has changed.
+     */
+    void prefetchNeighbours(bool intervalChanged);
+
+    /**
+     * Returns the geometry the renderer draws the ruler with, for the current range and dimensions.
+     * @return The geometry of the ruler.
+     */
+    [[nodiscard]] RulerRenderer::Geometry currentGeometry() const;
 
     /**
      * Creates a Ruler.
@@ -137,6 +450,114 @@ private:
      */
     void draw(GtkWidget *widget, cairo_t *cr);
 
+    /**
+     * Returns the key of the tick cache for the current state of the ruler.
+     * @return The key of the tick cache for the current state of the ruler.
+     */
+    [[nodiscard]] TickCacheKey currentTickCacheKey() const;
+
+    /**
+     * Returns the distance in whole pixels the contents of the tick cache have to be moved towards
+     * the origin to match the current range.
+     * @return The distance in pixels, or NAN if the contents of the cache can't be reused.
+     */
+    [[nodiscard]] double tickCacheShift() const;
+
+    /**
+     * Returns the distance in whole pixels ticks drawn for another range have to be moved towards
+     * the origin to match the current range.
+     * @param lower Lower limit of the range the ticks were drawn for.
+     * @param upper Upper limit of the range the ticks were drawn for.
+     * @param key The properties the ticks were drawn with.
+     * @return The distance in pixels, or NAN if the ticks differ by more than their position.
+     */
+    [[nodiscard]] double pixelShift(double lower, double upper, const TickCacheKey &key) const;
+
+    /**
+     * Brings the tick cache up-to-date with the current range and dimensions within a span along the ruler.
+     * If the range was panned, the cache is copied at an offset. Only the parts of the span that aren't
+     * up-to-date yet are rendered.
+     * @param start Start of the span along the ruler in pixels. Inclusive.
+     * @param end End of the span along the ruler in pixels. Exclusive.
+     */
+    void updateTickCache(double start, double end);
+
+    /**
+     * Clears and renders the ticks and labels that fall within a strip of the drawing area.
+     * @param cr Cairo context to draw to.
+     * @param start Start of the strip along the ruler in pixels. Inclusive.
+     * @param end End of the strip along the ruler in pixels. Exclusive.
+     */
+    void renderTickStrip(cairo_t *cr, double start, double end);
+
+    /**
+     * Returns the key of the current ticks in the shared tick cache.
+     * @return The key of the current ticks in the shared tick cache.
+     */
+    [[nodiscard]] SharedTickCache::Key sharedTickCacheKey() const;
+
+    /**
+     * Replaces the tick cache by the ticks of an identical ruler from the shared tick cache, if sharing is enabled.
+     * @return True if the shared tick cache had the current ticks.
+     */
+    bool adoptSharedTickCache();
+
+    /**
+     * Passes the Pango context of the widget to the renderer if labels are drawn in the font of the widget,
+     * or no context if they aren't.
+     * @return True if the labels will be laid out again, because the font has changed.
+     */
+    bool updateWidgetFont();
+
+    /**
+     * Creates a surface for the tick cache of the size of the drawing area, at the
+     * device resolution of its window, so the ticks stay sharp on HiDPI monitors.
+     * @return The new surface. Must be destroyed by the caller.
+     */
+    [[nodiscard]] cairo_surface_t *createTickCacheSurface() const;
+
+    /**
+     * Releases the surfaces of the tick cache.
+     */
+    void clearTickCache();
+
+    /**
+     * Starts a zoom transition if the interval has changed since the tick cache was rendered, and ends
+     * the transition in progress if it is done. A transition keeps the tick cache as the layer that is
+     * faded out, and renders the ticks of the new interval over the full length of the ruler.
+     */
+    void updateZoomTransition();
+
+    /**
+     * Paints both layers of the zoom transition, cross-faded by the time since the transition started.
+     * @param cr Cairo context to draw to.
+     */
+    void drawZoomTransition(cairo_t *cr);
+
+    /**
+     * Paints a layer of ticks rendered for another range, scaled and moved along the ruler to the current range.
+     * @param cr Cairo context to draw to.
+     * @param layer The layer to paint.
+     * @param layerLower Lower limit of the range the layer was rendered for.
+     * @param layerUpper Upper limit of the range the layer was rendered for.
+     * @param alpha The opacity to paint the layer with.
+     */
+    void paintScaledLayer(cairo_t *cr, cairo_surface_t *layer, double layerLower, double layerUpper, double alpha) const;
+
+    /**
+     * Releases the layer that is faded out, which ends the zoom transition in progress.
+     */
+    void endZoomTransition();
+
+    /**
+     * A tick callback of the widget's frame clock. Redraws the ruler every frame while a zoom transition is in progress.
+     * @param widget The widget the callback was added to.
+     * @param frameClock The frame clock of the widget.
+     * @param data Pointer to a ruler instance.
+     * @returns G_SOURCE_CONTINUE while the transition is in progress, G_SOURCE_REMOVE afterwards.
+     */
+    static gboolean zoomTransitionCallback(GtkWidget *widget, GdkFrameClock *frameClock, gpointer data);
+
     /**
      * A callback to be connected to a GtkDrawingArea's "size-allocate" signal.
      * Updates the internal state of the ruler when the size of the ruler changes.
@@ -147,91 +568,72 @@ private:
     static void sizeAllocateCallback(GtkWidget *widget, GdkRectangle *allocation, gpointer data);
 
     /**
-     * Calculates an appropriate interval between major ticks, given the current range and dimensions.
+     * A callback to be connected to a GtkDrawingArea's "notify::scale-factor" signal.
+     * Redraws the ruler at the new scale factor, for example when its window is moved to another monitor.
+     * @param widget The widget that received the signal.
+     * @param pspec The specification of the property that changed.
+     * @param data Pointer to a ruler instance.
      */
-    void calculateTickIntervals();
+    static void scaleFactorCallback(GtkWidget *widget, GParamSpec *pspec, gpointer data);
 
     /**
-     * Draws the tick marks of the ruler for a given subset of the range from left-to-right / bottom-to-top.
-     * @param cr Cairo context to draw to.
-     * @param lower The lower limit of the range to draw.
-     * @param upper The upper limit of the range to draw.
-     * @param lineLength Length of the lines in pixels.
+     * A callback to be connected to a GtkDrawingArea's "style-updated" signal.
+     * Redraws the labels if they are drawn in the font of the widget, and the font has changed.
+     * Changes of the font in the GTK settings reach the widget through this signal as well.
+     * @param widget The widget that received the signal.
+     * @param data Pointer to a ruler instance.
      */
-    void drawTicks(cairo_t *cr, double lower, double upper, double lineLength);
+    static void styleUpdatedCallback(GtkWidget *widget, gpointer data);
 
     /**
-     * Draws a single tick, taking into account the ruler's orientation.
-     * @param cr Cairo context to draw to.
-     * @param linePosition The position of the line along the ruler.
-     * @param lineLength Length of the line in pixels.
-     * @param drawLabel True if a label should be drawn to the right/top of the line.
-     * @param label The label to draw if \p drawLabel is true.
+     * A tick callback of the widget's frame clock. Resolves the pending update once per frame.
+     * @param widget The widget the callback was added to.
+     * @param frameClock The frame clock of the widget.
+     * @param data Pointer to a ruler instance.
+     * @returns G_SOURCE_REMOVE, since the callback is only needed until the pending update is resolved.
      */
-    void drawSingleTick(cairo_t *cr, double linePosition, double lineLength, bool drawLabel, const std::string &label);
+    static gboolean frameClockCallback(GtkWidget *widget, GdkFrameClock *frameClock, gpointer data);
 
     /**
-     * Draws the smaller ticks in between the major ticks from left-to-right / bottom-to-top.
-     * @param cr Cairo context to draw to.
-     * @param lower The lower limit of the range in draw space.
-     * @param upper The upper limit of the range in draw space.
-     * @param depth The depth of this recursive function. Functions as an index into the ruler's SUBTICK_SEGMENTS array.
-     * @param lineLength Length of the lines in pixels.
+     * Records that the range or size of the ruler has changed. Resolves the update immediately,
+     * or schedules it for the next frame if updates are coalesced.
      */
-    void drawSubTicks(cairo_t *cr, double lower, double upper, int depth, double lineLength);
-};
+    void requestUpdate();
 
-/**
- * This class contains the functions a Ruler uses to calculate the interval between major ticks.
- */
-class RulerCalculations
-{
-private:
-    /** The minimum space between major ticks. */
-    static constexpr int MIN_SPACE_MAJORTICKS{80};
+    /**
+     * Calculates the tick intervals for the pending update and redraws the ruler.
+     */
+    void resolveUpdate();
 
-    /** Valid intervals between major ticks. */
-    constexpr static std::array<int, 4> VALID_INTERVALS{
-            1,  5, 10, 25
-    };
+    /**
+     * Invalidates the parts of the widget that look different since the ruler was last invalidated.
+     * A pan by whole pixels moves the contents of the widget's window and only invalidates the strip
+     * that comes into view, and the ticks and labels close to the edges. Any other change invalidates
+     * the union of the spans covered by ticks before and after the change.
+     */
+    void invalidateChanges();
 
-public:
     /**
-     * Calculates an appropriate interval between major ticks on a ruler.
-     * @param lower Lower limit of the ruler range. Must be strictly less than \p upper.
-     * @param upper Upper limit of the ruler range. Must be strictly greater than \p lower.
-     * @param allocatedSize The allocated width/height in pixels for the ruler.
-     * @return The interval between ticks, or -1 if the given range is invalid.
+     * Invalidates a span along the ruler, across the full width/height of the widget.
+     * @param start Start of the span along the ruler in pixels.
+     * @param end End of the span along the ruler in pixels.
      */
-    static int calculateInterval(double lower, double upper, double allocatedSize);
+    void invalidateSpan(double start, double end);
 
     /**
-     * Calculates the spacing in pixels between tick marks for a given interval.
-     * @param interval The interval to calculate the spacing for.
-     * @param lower Lower limit of the ruler range. Must be strictly less than \p upper.
-     * @param upper Upper limit of the ruler range. Must be strictly greater than \p lower.
-     * @param allocatedSize The allocated width/height in pixels for the ruler.
-     * @return The spacing in pixels between tick marks for a given interval, or -1 if the given range is invalid.
+     * Returns the position of the marker along the ruler in pixels, for the current range and dimensions.
+     * @return The position of the marker in pixels, or NAN if the marker is hidden or the range is invalid.
      */
-    static int intervalPixelSpacing(double interval, double lower, double upper, double allocatedSize);
+    [[nodiscard]] double markerPixelPosition() const;
 
     /**
-     * Returns the position in the ruler range to start drawing from.
-     * @param lower The lower limit of the ruler range.
-     * @param interval The interval between major ticks that the ruler will be drawn with.
-     * @return The position of in the ruler to start drawing from.
+     * Invalidates the span along the ruler covered by the marker at a position.
+     * @param pixelPosition The position of the marker along the ruler in pixels. Nothing is invalidated if NAN.
      */
-    static int firstTick(double lower, int interval);
+    void invalidateMarker(double pixelPosition);
 
     /**
-     * Scales a number \p x in the range [\p src_lower, \p src_upper] to the range [\p dest_lower, \p dest_upper].
-     * Used to scale from the ruler range to the drawing space.
-     * @param x The number to scale.
-     * @param src_lower The lower limit of the source range. Inclusive.
-     * @param src_upper The upper limit of the source range. Inclusive.
-     * @param dest_lower The lower limit of the destination range. Inclusive.
-     * @param dest_upper The upper limit of the destination range. Inclusive.
-     * @return The result of \p x scaled from range source to dest.
+     * Calculates an appropriate interval between major ticks, given the current range and dimensions.
      */
-    static double scaleToRange(double x, double src_lower, double src_upper, double dest_lower, double dest_upper);
-};
\ No newline at end of file
+    void calculateTickIntervals();
+};
@@ -0,0 +1,248 @@
+#include "rulercalculations.hh"
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <system_error>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RULER_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    /** 10^n for every number of decimals of a label. All are exact. */
+    constexpr std::array<double, RulerCalculations::MAX_LABEL_DECIMALS + 1> POWERS_OF_TEN = []() {
+        std::array<double, RulerCalculations::MAX_LABEL_DECIMALS + 1> powers{};
+        double power = 1;
+        for (double &entry : powers)
+        {
+            entry = power;
+            power *= 10;
+        }
+        return powers;
+    }();
+
+    /** Labels with decimals are formatted from a 64-bit integer, which must stay below this. */
+    constexpr double MAX_SCALED_LABEL{9e18};
+
+    /** Whole labels from this size on don't fit in a 64-bit integer, so they are formatted from the double. */
+    constexpr double MAX_INTEGER_LABEL{9.2e18};
+
+    /**
+     * Scales numbers one at a time, the same way the single number version of scaleToRange() does.
+     */
+    void scaleScalar(const double *x, double *result, size_t count, double srcLower, double scale, double destLower)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            result[i] = destLower + round(scale * (x[i] - srcLower));
+        }
+    }
+
+#ifdef RULER_X86_KERNELS
+    // SSE2 can't truncate doubles outside the range of a 32-bit integer, so the smallest
+    // vector kernel needs SSE4.1. Both kernels round half away from zero like round():
+    // they truncate, and step one away from zero if the dropped fraction is at least a half.
+    // The fraction of a double is always exact, so this gives the same result in every case.
+
+    __attribute__((target("sse4.1"))) void
+      scaleSse41(const double *x, double *result, size_t count, double srcLower, double scale, double destLower)
+    {
+        const __m128d SRC_LOWER = _mm_set1_pd(srcLower);
+        const __m128d SCALE = _mm_set1_pd(scale);
+        const __m128d DEST_LOWER = _mm_set1_pd(destLower);
+        const __m128d HALF = _mm_set1_pd(0.5);
+        const __m128d ONE = _mm_set1_pd(1);
+        const __m128d SIGN = _mm_set1_pd(-0.0);
+
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            const __m128d SCALED = _mm_mul_pd(SCALE, _mm_sub_pd(_mm_loadu_pd(x + i), SRC_LOWER));
+            const __m128d TRUNCATED = _mm_round_pd(SCALED, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+            const __m128d FRACTION = _mm_andnot_pd(SIGN, _mm_sub_pd(SCALED, TRUNCATED));
+            const __m128d STEP = _mm_and_pd(_mm_cmpge_pd(FRACTION, HALF), _mm_or_pd(_mm_and_pd(SCALED, SIGN), ONE));
+            _mm_storeu_pd(result + i, _mm_add_pd(DEST_LOWER, _mm_add_pd(TRUNCATED, STEP)));
+        }
+        scaleScalar(x + i, result + i, count - i, srcLower, scale, destLower);
+    }
+
+    __attribute__((target("avx2"))) void
+      scaleAvx2(const double *x, double *result, size_t count, double srcLower, double scale, double destLower)
+    {
+        const __m256d SRC_LOWER = _mm256_set1_pd(srcLower);
+        const __m256d SCALE = _mm256_set1_pd(scale);
+        const __m256d DEST_LOWER = _mm256_set1_pd(destLower);
+        const __m256d HALF = _mm256_set1_pd(0.5);
+        const __m256d ONE = _mm256_set1_pd(1);
+        const __m256d SIGN = _mm256_set1_pd(-0.0);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m256d SCALED = _mm256_mul_pd(SCALE, _mm256_sub_pd(_mm256_loadu_pd(x + i), SRC_LOWER));
+            const __m256d TRUNCATED = _mm256_round_pd(SCALED, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+            const __m256d FRACTION = _mm256_andnot_pd(SIGN, _mm256_sub_pd(SCALED, TRUNCATED));
+            const __m256d STEP =
+              _mm256_and_pd(_mm256_cmp_pd(FRACTION, HALF, _CMP_GE_OQ), _mm256_or_pd(_mm256_and_pd(SCALED, SIGN), ONE));
+            _mm256_storeu_pd(result + i, _mm256_add_pd(DEST_LOWER, _mm256_add_pd(TRUNCATED, STEP)));
+        }
+        scaleSse41(x + i, result + i, count - i, srcLower, scale, destLower);
+    }
+#endif
+
+    /**
+     * Returns the fastest kernel of the batch version of scaleToRange() the processor supports.
+     * @return The fastest supported kernel.
+     */
+    RulerCalculations::Kernel fastestKernel()
+    {
+        static const RulerCalculations::Kernel FASTEST = []() {
+            if (RulerCalculations::kernelSupported(RulerCalculations::Kernel::AVX2)) { return RulerCalculations::Kernel::AVX2; }
+            if (RulerCalculations::kernelSupported(RulerCalculations::Kernel::SSE4_1)) { return RulerCalculations::Kernel::SSE4_1; }
+            return RulerCalculations::Kernel::SCALAR;
+        }();
+        return FASTEST;
+    }
+} // namespace
+
+////////////////////////////////////////////////////////////////////////
+// RulerCalculations
+
+double RulerCalculations::scaleToRange(double x, double src_lower, double src_upper, double dest_lower, double dest_upper)
+{
+    double src_size = src_upper - src_lower;
+    double dest_size = dest_upper - dest_lower;
+    double scale = dest_size / src_size;
+
+    return dest_lower + round(scale * (x - src_lower));
+}
+
+void RulerCalculations::scaleToRange(const double *x,
+                                     double       *result,
+                                     size_t        count,
+                                     double        src_lower,
+                                     double        src_upper,
+                                     double        dest_lower,
+                                     double        dest_upper,
+                                     Kernel        kernel)
+{
+    double src_size = src_upper - src_lower;
+    double dest_size = dest_upper - dest_lower;
+    double scale = dest_size / src_size;
+
+    if (kernel == Kernel::AUTOMATIC) { kernel = fastestKernel(); }
+
+    switch (kernel)
+    {
+#ifdef RULER_X86_KERNELS
+    case Kernel::AVX2:
+        scaleAvx2(x, result, count, src_lower, scale, dest_lower);
+        break;
+    case Kernel::SSE4_1:
+        scaleSse41(x, result, count, src_lower, scale, dest_lower);
+        break;
+#endif
+    default:
+        scaleScalar(x, result, count, src_lower, scale, dest_lower);
+        break;
+    }
+}
+
+bool RulerCalculations::kernelSupported(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Kernel::AUTOMATIC:
+    case Kernel::SCALAR:
+        return true;
+#ifdef RULER_X86_KERNELS
+    case Kernel::SSE4_1:
+        return __builtin_cpu_supports("sse4.1") != 0;
+    case Kernel::AVX2:
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    default:
+        return false;
+    }
+}
+
+double RulerCalculations::resolution(double lower, double upper)
+{
+    const double MAGNITUDE = std::max(fabs(lower), fabs(upper));
+    return nextafter(MAGNITUDE, INFINITY) - MAGNITUDE;
+}
+
+int RulerCalculations::intervalPixelSpacing(double interval, double lower, double upper, double allocatedSize)
+{
+    if (upper <= lower) { return -1; }
+
+    const double RANGE_SIZE = upper - lower;
+    return static_cast<int>(round((allocatedSize / RANGE_SIZE) * interval));
+}
+
+double RulerCalculations::firstTick(double lower, double interval)
+{
+    return floor(lower / interval) * interval;
+}
+
+int RulerCalculations::labelDecimals(double interval, double lower, double upper)
+{
+    // Decimals finer than the distance between neighbouring doubles in the range would only show rounding noise
+    const double RESOLUTION = resolution(lower, upper);
+    int maxDecimals = MAX_LABEL_DECIMALS;
+    while (maxDecimals > 0 && RESOLUTION * POWERS_OF_TEN.at(maxDecimals) > 1) { maxDecimals--; }
+
+    for (int decimals = 0; decimals < maxDecimals; decimals++)
+    {
+        // A fractional interval is the nearest double to a decimal fraction, so scaling it is off by a tiny bit
+        const double SCALED = interval * POWERS_OF_TEN.at(decimals);
+        if (fabs(SCALED - round(SCALED)) <= 1e-9 * fabs(SCALED)) { return decimals; }
+    }
+    return maxDecimals;
+}
+
+const char *RulerCalculations::formatLabel(double value, LabelBuffer &buffer, int decimals)
+{
+    while (decimals > 0 && fabs(value) * POWERS_OF_TEN.at(decimals) >= MAX_SCALED_LABEL) { decimals--; }
+
+    // Leave room for the null terminator
+    char *const END = buffer.data() + buffer.size() - 1;
+    if (decimals == 0 && fabs(value) >= MAX_INTEGER_LABEL)
+    {
+        // Such doubles are whole numbers already. Written out in full if they fit, in scientific notation if not
+        std::to_chars_result result = std::to_chars(buffer.data(), END, value, std::chars_format::fixed);
+        if (result.ec != std::errc{}) { result = std::to_chars(buffer.data(), END, value, std::chars_format::scientific); }
+        *result.ptr = '\0';
+        return buffer.data();
+    }
+    if (decimals == 0)
+    {
+        const std::to_chars_result RESULT = std::to_chars(buffer.data(), END, static_cast<int64_t>(floor(value)));
+        *RESULT.ptr = '\0';
+        return buffer.data();
+    }
+
+    // Format the label as a whole number of 10^-decimals, with the decimal point inserted
+    const int64_t SCALED = llround(value * POWERS_OF_TEN.at(decimals));
+    const uint64_t MAGNITUDE = (SCALED < 0) ? 0 - static_cast<uint64_t>(SCALED) : static_cast<uint64_t>(SCALED);
+    const auto DIVISOR = static_cast<uint64_t>(POWERS_OF_TEN.at(decimals));
+
+    char *position = buffer.data();
+    if (SCALED < 0) { *position++ = '-'; }
+    position = std::to_chars(position, END, MAGNITUDE / DIVISOR).ptr;
+    *position++ = '.';
+
+    // The fractional part keeps its leading zeros
+    uint64_t fraction = MAGNITUDE % DIVISOR;
+    for (int i = decimals - 1; i >= 0; i--)
+    {
+        position[i] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+    position[decimals] = '\0';
+    return buffer.data();
+}
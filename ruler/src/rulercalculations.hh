@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+#include "tickpolicies.hh"
+
+/**
+ * This class contains the functions a Ruler uses to calculate the interval between major ticks
+ * and to format their labels.
+ */
+class RulerCalculations
+{
+private:
+    /** The minimum space between major ticks. */
+    static constexpr int MIN_SPACE_MAJORTICKS{80};
+
+    /** The minimum interval between major ticks, in units in the last place of the ends of the ruler range. */
+    static constexpr double MIN_INTERVAL_ULPS{8};
+
+    /**
+     * Returns the distance between neighbouring doubles at the end of a range furthest from zero.
+     * Positions in the range can't be told apart more finely than this.
+     * @param lower Lower limit of the range.
+     * @param upper Upper limit of the range.
+     * @return The unit in the last place of the larger of |\p lower| and |\p upper|.
+     */
+    static double resolution(double lower, double upper);
+
+    /**
+     * Returns a candidate interval between major ticks of a tick policy.
+     * Candidates are numbered from smallest to largest, starting at 0 for the smallest fractional interval.
+     * @tparam Policy The tick policy the candidates belong to.
+     * @param ordinal The number of the candidate.
+     * @return The candidate interval, or -1 if the candidate is 1 or more and isn't a whole number.
+     */
+    template <typename Policy>
+    static double candidateInterval(int ordinal);
+
+    /**
+     * Returns whether the major ticks of a candidate interval are spaced far enough apart.
+     * @tparam Policy The tick policy the candidate belongs to.
+     * @param ordinal The number of the candidate.
+     * @param lower Lower limit of the ruler range.
+     * @param upper Upper limit of the ruler range.
+     * @param allocatedSize The allocated width/height in pixels for the ruler.
+     * @param labelSpace The space the labels of the major ticks need in pixels.
+     * @param minInterval The smallest interval the positions in the range can be resolved at.
+     * @return True if the candidate is a valid interval of at least \p minInterval, with a spacing of
+     *         at least MIN_SPACE_MAJORTICKS, and more than \p labelSpace.
+     */
+    template <typename Policy>
+    static bool candidateFits(int ordinal, double lower, double upper, double allocatedSize, double labelSpace, double minInterval);
+
+public:
+    /** The implementations of the batch version of scaleToRange(). All give bit-identical results. */
+    enum class Kernel
+    {
+        /** The fastest kernel the processor supports. */
+        AUTOMATIC,
+        SCALAR,
+        SSE4_1,
+        AVX2
+    };
+
+    /**
+     * Buffer a tick label is formatted into. Large enough for any 64-bit integer, its sign, a decimal point,
+     * a leading zero and a null terminator, and for any double in scientific notation.
+     */
+    using LabelBuffer = std::array<char, 32>;
+
+    /** The largest number of decimals a label is formatted with. */
+    static constexpr int MAX_LABEL_DECIMALS{15};
+
+    /**
+     * Calculates an appropriate interval between major ticks on a ruler.
+     * @tparam Policy The tick policy that decides which intervals are valid. See tickpolicies.hh.
+     * @param lower Lower limit of the ruler range. Must be strictly less than \p upper.
+     * @param upper Upper limit of the ruler range. Must be strictly greater than \p lower.
+     * @param allocatedSize The allocated width/height in pixels for the ruler.
+     * @param labelSpace The space the labels of the major ticks need in pixels. The spacing of the major ticks
+     *                   will be larger than this, so every label fits between its tick and the next.
+     * @return The interval between ticks, or -1 if the given range or size is invalid. Never less than
+     *         MIN_INTERVAL_ULPS units in the last place of the ends of the range, so that the ticks stay
+     *         evenly spaced far from zero.
+     */
+    template <typename Policy = DecimalTicks>
+    static double calculateInterval(double lower, double upper, double allocatedSize, double labelSpace = 0);
+
+    /**
+     * Calculates the spacing in pixels between tick marks for a given interval.
+     * @param interval The interval to calculate the spacing for.
+     * @param lower Lower limit of the ruler range. Must be strictly less than \p upper.
+     * @param upper Upper limit of the ruler range. Must be strictly greater than \p lower.
+     * @param allocatedSize The allocated width/height in pixels for the ruler.
+     * @return The spacing in pixels between tick marks for a given interval, or -1 if the given range is invalid.
+     */
+    static int intervalPixelSpacing(double interval, double lower, double upper, double allocatedSize);
+
+    /**
+     * Returns the position in the ruler range to start drawing from.
+     * @param lower The lower limit of the ruler range.
+     * @param interval The interval between major ticks that the ruler will be drawn with.
+     * @return The position of in the ruler to start drawing from.
+     */
+    static double firstTick(double lower, double interval);
+
+    /**
+     * Scales a number \p x in the range [\p src_lower, \p src_upper] to the range [\p dest_lower, \p dest_upper].
+     * Used to scale from the ruler range to the drawing space.
+     * @param x The number to scale.
+     * @param src_lower The lower limit of the source range. Inclusive.
+     * @param src_upper The upper limit of the source range. Inclusive.
+     * @param dest_lower The lower limit of the destination range. Inclusive.
+     * @param dest_upper The upper limit of the destination range. Inclusive.
+     * @return The result of \p x scaled from range source to dest.
+     */
+    static double scaleToRange(double x, double src_lower, double src_upper, double dest_lower, double dest_upper);
+
+    /**
+     * Scales an array of numbers in the range [\p src_lower, \p src_upper] to the range [\p dest_lower, \p dest_upper].
+     * The result for every number is bit-identical to that of the single number version, but the scale is only
+     * calculated once and the numbers are scaled several at a time if the processor supports it.
+     * Used to map the positions of many ticks or gridlines from the ruler range to the drawing space at once.
+     * @param x The numbers to scale.
+     * @param result Set to the scaled numbers. May be the same array as \p x.
+     * @param count The number of numbers to scale.
+     * @param src_lower The lower limit of the source range. Inclusive.
+     * @param src_upper The upper limit of the source range. Inclusive.
+     * @param dest_lower The lower limit of the destination range. Inclusive.
+     * @param dest_upper The upper limit of the destination range. Inclusive.
+     * @param kernel The implementation to use. Must be supported by the processor, see kernelSupported().
+     */
+    static void scaleToRange(const double *x,
+                             double       *result,
+                             size_t        count,
+                             double        src_lower,
+                             double        src_upper,
+                             double        dest_lower,
+                             double        dest_upper,
+                             Kernel        kernel = Kernel::AUTOMATIC);
+
+    /**
+     * Returns whether the processor supports a kernel of the batch version of scaleToRange().
+     * @param kernel The kernel to check.
+     * @return True if \p kernel can be used on this processor.
+     */
+    static bool kernelSupported(Kernel kernel);
+
+    /**
+     * Returns the number of decimals the labels of major ticks need for an interval, so that the labels of
+     * neighbouring ticks differ. Only needs to be calculated once per interval and range.
+     * @param interval The interval between major ticks.
+     * @param lower Lower limit of the ruler range.
+     * @param upper Upper limit of the ruler range.
+     * @return The number of decimals of the smallest multiple of 10^-n that \p interval is a multiple of,
+     *         but at most MAX_LABEL_DECIMALS, and without decimals finer than a double can resolve in the range.
+     */
+    static int labelDecimals(double interval, double lower = 0, double upper = 0);
+
+    /**
+     * Formats the label of a major tick into a buffer, without allocating memory.
+     * Without decimals, the label is the position of the tick, rounded down to a whole number. With decimals,
+     * the position is rounded to the nearest label, since multiples of fractional intervals aren't exact
+     * in binary. Decimals that don't fit in a 64-bit integer with the whole part are left out. Positions
+     * beyond the range of a 64-bit integer are written out from the double, or in scientific notation if
+     * they don't fit in the buffer that way.
+     * @param value The position of the tick in the ruler range.
+     * @param buffer The buffer to format the label into.
+     * @param decimals The number of decimals, see labelDecimals(). At most MAX_LABEL_DECIMALS.
+     * @return The null-terminated label, stored in \p buffer.
+     */
+    static const char *formatLabel(double value, LabelBuffer &buffer, int decimals = 0);
+};
+
+template <typename Policy>
+double RulerCalculations::calculateInterval(double lower, double upper, double allocatedSize, double labelSpace)
+{
+    // We need to calculate the distance between the largest ticks on the ruler
+    // Rather than trying every valid interval from smallest to largest, we estimate
+    // the smallest interval which will produce a spacing of a large enough width/height
+    // when drawn, and correct the estimate for the rounding of the spacing
+
+    if (upper <= lower || allocatedSize <= 0) { return -1; }
+
+    using Tables = TickTables<Policy>;
+    // Far from zero, ticks closer together than a few doubles would be placed unevenly and get the same labels
+    const double MIN_INTERVAL = MIN_INTERVAL_ULPS * resolution(lower, upper);
+    const double SMALLEST_INTERVAL =
+      std::max(std::max<double>(MIN_SPACE_MAJORTICKS, labelSpace) * (upper - lower) / allocatedSize, MIN_INTERVAL);
+
+    // Start at the first candidate of the cycle the smallest interval lies in
+    int ordinal = 0;
+    if (SMALLEST_INTERVAL > Tables::CANDIDATES[0])
+    {
+        const double CYCLE = (Policy::BASE == 10) ? floor(log10(SMALLEST_INTERVAL)) : floor(log(SMALLEST_INTERVAL) / log(Policy::BASE));
+        ordinal = (std::max(static_cast<int>(CYCLE), Tables::FIRST_CYCLE) - Tables::FIRST_CYCLE) * static_cast<int>(Tables::MANTISSA_COUNT);
+    }
+
+    // Try larger intervals until the spacing is large enough. This takes at most a few steps
+    while (!candidateFits<Policy>(ordinal, lower, upper, allocatedSize, labelSpace, MIN_INTERVAL)) { ordinal++; }
+
+    // Because of rounding, a smaller interval might fit as well
+    int smaller = ordinal - 1;
+    while (smaller >= 0)
+    {
+        if (candidateFits<Policy>(smaller, lower, upper, allocatedSize, labelSpace, MIN_INTERVAL)) { ordinal = smaller; }
+        else if (candidateInterval<Policy>(smaller) > 0) { break; }
+        smaller--;
+    }
+
+    return candidateInterval<Policy>(ordinal);
+}
+
+template <typename Policy>
+double RulerCalculations::candidateInterval(int ordinal)
+{
+    using Tables = TickTables<Policy>;
+    if (static_cast<size_t>(ordinal) < Tables::CANDIDATES.size()) { return Tables::CANDIDATES[ordinal]; }
+
+    // Past the table, every candidate is a whole number
+    const int MANTISSA_COUNT = static_cast<int>(Tables::MANTISSA_COUNT);
+    return Policy::MANTISSAS[ordinal % MANTISSA_COUNT] * pow(Policy::BASE, ordinal / MANTISSA_COUNT + Tables::FIRST_CYCLE);
+}
+
+template <typename Policy>
+bool RulerCalculations::candidateFits(int ordinal, double lower, double upper, double allocatedSize, double labelSpace, double minInterval)
+{
+    const double INTERVAL = candidateInterval<Policy>(ordinal);
+    if (INTERVAL <= 0 || INTERVAL < minInterval) { return false; }
+
+    // Calculate the drawn size for this interval by mapping from the ruler range
+    // to the ruler size on the screen
+    const int SPACING = intervalPixelSpacing(INTERVAL, lower, upper, allocatedSize);
+    return SPACING >= MIN_SPACE_MAJORTICKS && SPACING > labelSpace;
+}
@@ -0,0 +1,378 @@
+#include "rulerrenderer.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "rulerstats.hh"
+
+/**
+ * A horizontal ruler runs along the x-axis, with its ticks hanging down from the bottom edge.
+ * Labels are drawn left-to-right, after their tick.
+ */
+struct RulerRenderer::HorizontalAxis
+{
+    static constexpr double LABEL_DIRECTION{1};
+    static constexpr bool   ROTATED_LABELS{false};
+
+    static int    length(int width, int /*height*/) { return width; }
+    static int    thickness(int /*width*/, int height) { return height; }
+    static double x(double along, double /*across*/) { return along; }
+    static double y(double /*along*/, double across) { return across; }
+};
+
+/**
+ * A vertical ruler runs along the y-axis, with its ticks sticking out of the right edge.
+ * Labels are drawn bottom-to-top, before their tick.
+ */
+struct RulerRenderer::VerticalAxis
+{
+    static constexpr double LABEL_DIRECTION{-1};
+    static constexpr bool   ROTATED_LABELS{true};
+
+    static int    length(int /*width*/, int height) { return height; }
+    static int    thickness(int width, int /*height*/) { return width; }
+    static double x(double /*along*/, double across) { return across; }
+    static double y(double along, double /*across*/) { return along; }
+};
+
+int RulerRenderer::Geometry::length() const
+{
+    return (orientation == HORIZONTAL) ? width : height;
+}
+
+double RulerRenderer::Geometry::majorTickLength() const
+{
+    return (orientation == HORIZONTAL) ? MAJOR_TICK_LENGTH * height : MAJOR_TICK_LENGTH * width;
+}
+
+RulerRenderer::RulerRenderer()
+        : RulerRenderer(Style{})
+{
+}
+
+RulerRenderer::RulerRenderer(Style newStyle, TickPolicy newTickPolicy)
+        : style{std::move(newStyle)}
+        , tickPolicy{std::move(newTickPolicy)}
+{
+    // The intervals can be chosen before anything is drawn, so the label cache needs the font right away
+    labelCache.setStyle(this->style.fontFamily, this->style.fontSize, this->style.lineColor, 1);
+}
+
+double RulerRenderer::majorInterval(double lower, double upper, double drawAreaSize)
+{
+    // Where the tick just before the range is, and how many decimals the labels have, depends
+    // on the interval, so the space for the labels grows until the interval fits them
+    double space = 0;
+    while (true)
+    {
+        const double INTERVAL = tickPolicy.calculateInterval(lower, upper, drawAreaSize, space);
+        if (INTERVAL <= 0) { return INTERVAL; }
+
+        const double ADVANCE = labelSpace(lower, upper, INTERVAL, RulerCalculations::labelDecimals(INTERVAL, lower, upper));
+        if (ADVANCE <= space) { return INTERVAL; }
+        space = ADVANCE;
+    }
+}
+
+double RulerRenderer::labelSpace(double lower, double upper, double interval, int decimals)
+{
+    const LabelCache::Metrics &metrics = labelCache.getMetrics();
+    RulerCalculations::LabelBuffer label{};
+
+    // The longest labels are at either end of the range. That includes the label
+    // of the tick just before the range, which is partly visible
+    const double FIRST_ADVANCE =
+      metrics.estimateAdvance(RulerCalculations::formatLabel(RulerCalculations::firstTick(lower, interval), label, decimals));
+    const double UPPER_ADVANCE = metrics.estimateAdvance(RulerCalculations::formatLabel(upper, label, decimals));
+    return std::max(FIRST_ADVANCE, UPPER_ADVANCE);
+}
+
+RulerRenderer::Geometry RulerRenderer::geometry(Orientation orientation, double lower, double upper, int width, int height)
+{
+    Geometry result{orientation, lower, upper, width, height};
+    const double DRAW_AREA_SIZE = result.length();
+    result.majorInterval = majorInterval(lower, upper, DRAW_AREA_SIZE);
+    result.majorTickSpacing = RulerCalculations::intervalPixelSpacing(result.majorInterval, lower, upper, DRAW_AREA_SIZE);
+    result.labelDecimals = RulerCalculations::labelDecimals(result.majorInterval, lower, upper);
+    return result;
+}
+
+const RulerRenderer::Style &RulerRenderer::getStyle() const
+{
+    return style;
+}
+
+void RulerRenderer::setTickPolicy(TickPolicy newTickPolicy)
+{
+    tickPolicy = std::move(newTickPolicy);
+    tickLayout = TickLayout{tickPolicy.subdivision};
+}
+
+const RulerRenderer::TickPolicy &RulerRenderer::getTickPolicy() const
+{
+    return tickPolicy;
+}
+
+void RulerRenderer::render(cairo_t *cr, Orientation orientation, double lower, double upper, int width, int height)
+{
+    const Geometry GEOMETRY = geometry(orientation, lower, upper, width, height);
+
+    cairo_save(cr);
+    cairo_rectangle(cr, 0, 0, width, height);
+    cairo_clip(cr);
+
+    gdk_cairo_set_source_rgba(cr, &style.backgroundColor);
+    cairo_paint(cr);
+
+    drawBorders(cr, GEOMETRY);
+    if (GEOMETRY.majorInterval > 0) { drawTicks(cr, GEOMETRY, 0, GEOMETRY.length()); }
+
+    cairo_restore(cr);
+}
+
+void RulerRenderer::render(cairo_surface_t *surface, Orientation orientation, double lower, double upper, int width, int height)
+{
+    cairo_t *cr = cairo_create(surface);
+    render(cr, orientation, lower, upper, width, height);
+    cairo_destroy(cr);
+    cairo_surface_flush(surface);
+}
+
+void RulerRenderer::drawBorders(cairo_t *cr, const Geometry &geometry)
+{
+    const int width = geometry.width;
+    const int height = geometry.height;
+
+    // Draw outline along left and right sides and along the bottom
+    gdk_cairo_set_source_rgba(cr, &style.lineColor);
+    cairo_set_line_width(cr, LINE_WIDTH);
+    // Cairo integer coordinates map to points halfway between pixels.
+    // We need to offset the coordinates by 0.5 times the line width
+    // to get clear lines
+    double drawOffset = LINE_WIDTH * LINE_COORD_OFFSET;
+    if (geometry.orientation == HORIZONTAL)
+    {
+        // Draw line along left side of ruler
+        cairo_move_to(cr, drawOffset, 0);
+        cairo_line_to(cr, drawOffset, height);
+
+        // Draw line along right side of ruler
+        cairo_move_to(cr, width - drawOffset, 0);
+        cairo_line_to(cr, width - drawOffset, height);
+        // Render both lines
+        cairo_stroke(cr);
+        RULER_STAT(counts.strokes++);
+
+        // Draw thicker border along bottom of ruler
+        cairo_set_line_width(cr, 2 * LINE_WIDTH);
+        drawOffset = 2 * LINE_WIDTH * LINE_COORD_OFFSET;
+        cairo_move_to(cr, 0, height - drawOffset);
+        cairo_line_to(cr, width, height - drawOffset);
+        cairo_stroke(cr);
+        RULER_STAT(counts.strokes++);
+    }
+    else
+    {
+        // Draw line along top side of ruler
+        cairo_move_to(cr, 0, drawOffset);
+        cairo_line_to(cr, width, drawOffset);
+
+        // Draw line along bottom side of ruler
+        cairo_move_to(cr, 0, height - drawOffset);
+        cairo_line_to(cr, width, height - drawOffset);
+        // Render both lines
+        cairo_stroke(cr);
+        RULER_STAT(counts.strokes++);
+
+        // Draw thicker border along right of ruler
+        cairo_set_line_width(cr, 2 * LINE_WIDTH);
+        drawOffset = 2 * LINE_WIDTH * LINE_COORD_OFFSET;
+        cairo_move_to(cr, width - drawOffset, 0);
+        cairo_line_to(cr, width - drawOffset, height);
+        cairo_stroke(cr);
+        RULER_STAT(counts.strokes++);
+    }
+    cairo_set_line_width(cr, LINE_WIDTH);
+}
+
+void RulerRenderer::drawTicks(cairo_t *cr, const Geometry &geometry, double start, double end)
+{
+    // Only lay out the ticks that are visible in the strip
+    tickLayout.computeVisible(geometry.lower,
+                              geometry.upper,
+                              geometry.length(),
+                              geometry.majorInterval,
+                              geometry.majorTickSpacing,
+                              geometry.majorTickLength(),
+                              start,
+                              end);
+    RULER_STAT(counts.tickLayouts++);
+    drawTicks(cr, geometry, tickLayout);
+}
+
+void RulerRenderer::drawTicks(cairo_t *cr, const Geometry &geometry, const TickLayout &layout)
+{
+    gdk_cairo_set_source_rgba(cr, &style.lineColor);
+    cairo_set_line_width(cr, LINE_WIDTH);
+
+    // Decide on the orientation once, rather than for every tick
+    if (geometry.orientation == HORIZONTAL)
+    {
+        drawTicks<HorizontalAxis>(cr, geometry, layout);
+    }
+    else
+    {
+        drawTicks<VerticalAxis>(cr, geometry, layout);
+    }
+}
+
+template <typename Axis>
+void RulerRenderer::drawTicks(cairo_t *cr, const Geometry &geometry, const TickLayout &layout)
+{
+    const std::vector<double> &positions = layout.getPositions();
+    const std::vector<double> &lengths = layout.getLengths();
+    const std::vector<int> &labelIndices = layout.getLabelIndices();
+    const std::vector<double> &labelValues = layout.getLabelValues();
+    const std::vector<size_t> &levelOrder = layout.getLevelOrder();
+    const std::vector<size_t> &levelStarts = layout.getLevelStarts();
+    const size_t TICK_COUNT = layout.getTickCount();
+
+    // All lines of the same length are collected into a single path, which is stroked
+    // once. Level 0 contains the major ticks, the levels below contain the sub-ticks.
+    // The layout groups the ticks by level, so every tick is only visited once
+    for (int level = 0; level < layout.getLevelCount(); level++)
+    {
+        bool hasLines = false;
+        for (size_t k = levelStarts[level]; k < levelStarts[level + 1]; k++)
+        {
+            const size_t i = levelOrder[k];
+            hasLines |= addTickLine<Axis>(cr, geometry, positions[i], lengths[i]);
+        }
+        // A level may have no lines in this strip, and then there is nothing to stroke
+        if (!hasLines) { continue; }
+
+        cairo_stroke(cr);
+        RULER_STAT(counts.strokes++);
+    }
+
+    // The labels are rendered at the device resolution of the surface they are drawn to
+    labelCacheFor(cr);
+
+    // Draw the labels on top of the lines. They are formatted on the stack, so no memory is allocated
+    RulerCalculations::LabelBuffer label{};
+    for (size_t i = 0; i < TICK_COUNT; i++)
+    {
+        if (labelIndices[i] == TickLayout::NO_LABEL) { continue; }
+
+        drawLabel<Axis>(cr, geometry, positions[i], lengths[i], RulerCalculations::formatLabel(labelValues[labelIndices[i]], label, geometry.labelDecimals));
+    }
+}
+
+void RulerRenderer::drawMarker(cairo_t *cr, const Geometry &geometry, double pixelPosition)
+{
+    if (geometry.orientation == HORIZONTAL)
+    {
+        drawMarker<HorizontalAxis>(cr, geometry, pixelPosition);
+    }
+    else
+    {
+        drawMarker<VerticalAxis>(cr, geometry, pixelPosition);
+    }
+}
+
+template <typename Axis>
+void RulerRenderer::drawMarker(cairo_t *cr, const Geometry &geometry, double pixelPosition)
+{
+    const double DRAW_AREA_SIZE = Axis::length(geometry.width, geometry.height);
+    if (pixelPosition + MARKER_HALF_WIDTH < 0 || pixelPosition - MARKER_HALF_WIDTH > DRAW_AREA_SIZE) { return; }
+
+    // The tip of the triangle touches the edge of the ruler, like the tick lines
+    const double ALONG = pixelPosition + LINE_WIDTH * LINE_COORD_OFFSET;
+    const double EDGE = Axis::thickness(geometry.width, geometry.height);
+    const double BASE = EDGE - round(MARKER_LENGTH * EDGE);
+    cairo_move_to(cr, Axis::x(ALONG, EDGE), Axis::y(ALONG, EDGE));
+    cairo_line_to(cr, Axis::x(ALONG - MARKER_HALF_WIDTH, BASE), Axis::y(ALONG - MARKER_HALF_WIDTH, BASE));
+    cairo_line_to(cr, Axis::x(ALONG + MARKER_HALF_WIDTH, BASE), Axis::y(ALONG + MARKER_HALF_WIDTH, BASE));
+    cairo_close_path(cr);
+    gdk_cairo_set_source_rgba(cr, &style.lineColor);
+    cairo_fill(cr);
+}
+
+template <typename Axis>
+bool RulerRenderer::addTickLine(cairo_t *cr, const Geometry &geometry, double linePosition, double lineLength)
+{
+    const double DRAW_AREA_SIZE = Axis::length(geometry.width, geometry.height);
+    // Add the line if is within the drawing area
+    if (0 < linePosition && linePosition < DRAW_AREA_SIZE)
+    {
+        // Offset the line to get a clear line. The line starts at the edge of the ruler
+        const double ALONG = linePosition + LINE_WIDTH * LINE_COORD_OFFSET;
+        const double EDGE = Axis::thickness(geometry.width, geometry.height);
+        const double END = EDGE - round(lineLength);
+        cairo_move_to(cr, Axis::x(ALONG, EDGE), Axis::y(ALONG, EDGE));
+        cairo_line_to(cr, Axis::x(ALONG, END), Axis::y(ALONG, END));
+        RULER_STAT(counts.ticks++);
+        return true;
+    }
+    return false;
+}
+
+template <typename Axis>
+void RulerRenderer::drawLabel(cairo_t *cr, const Geometry &geometry, double linePosition, double lineLength, const char *label)
+{
+    const double DRAW_AREA_SIZE = Axis::length(geometry.width, geometry.height);
+
+    // The interval between major ticks leaves room for every label, so
+    // labels are placed from the metrics of the font rather than measured
+    const LabelCache::Metrics &metrics = labelCache.getMetrics();
+    // Draw the label if at least part of the text is within the drawing area
+    if (linePosition + metrics.estimateAdvance(label) > 0 && linePosition < DRAW_AREA_SIZE)
+    {
+        RULER_STAT(counts.labels++);
+        // Center the text on the line
+        const double ALONG = linePosition + Axis::LABEL_DIRECTION * LABEL_OFFSET;
+        const double ACROSS = Axis::thickness(geometry.width, geometry.height) - LABEL_ALIGN * lineLength - LINE_MULTIPLIER * metrics.digitTop;
+        labelCache.drawLabel(cr, label, Axis::x(ALONG, ACROSS), Axis::y(ALONG, ACROSS), Axis::ROTATED_LABELS);
+    }
+}
+
+LabelCache &RulerRenderer::labelCacheFor(cairo_t *cr)
+{
+    double scaleX{1};
+    double scaleY{1};
+    cairo_surface_get_device_scale(cairo_get_target(cr), &scaleX, &scaleY);
+    labelCache.setStyle(style.fontFamily, style.fontSize, style.lineColor, scaleX);
+    return labelCache;
+}
+
+void RulerRenderer::setLabelCacheEnabled(bool enabled)
+{
+    labelCache.setEnabled(enabled);
+}
+
+void RulerRenderer::setGlyphAtlasEnabled(bool enabled)
+{
+    labelCache.setGlyphAtlasEnabled(enabled);
+}
+
+bool RulerRenderer::setPangoContext(PangoContext *context)
+{
+    return labelCache.setPangoContext(context);
+}
+
+const LabelCache::Stats &RulerRenderer::getLabelCacheStats() const
+{
+    return labelCache.getStats();
+}
+
+const RulerRenderer::Counts &RulerRenderer::getCounts() const
+{
+    return counts;
+}
+
+void RulerRenderer::resetCounts()
+{
+    counts = Counts{};
+    labelCache.resetStats();
+}
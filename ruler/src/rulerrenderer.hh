@@ -0,0 +1,398 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <gtk/gtk.h>
+
+#include "labelcache.hh"
+#include "rulercalculations.hh"
+#include "ticklayout.hh"
+
+/**
+ * This class draws a ruler to any Cairo context or surface, for an explicit range, size, orientation and style.
+ * It doesn't need a GTK widget, so it can be used to burn rulers into exported images without a display.
+ * The Ruler widget uses it to draw its borders, ticks, labels and marker.
+ *
+ * A renderer keeps its own label cache and tick layout, so it must only be used by one thread at a time.
+ * Use a RulerRenderPool to render many rulers in parallel.
+ */
+class RulerRenderer
+{
+public:
+    enum Orientation
+    {
+        HORIZONTAL, VERTICAL
+    };
+
+    /** The font and colours a ruler is drawn with. */
+    struct Style
+    {
+        std::string fontFamily{"sans-serif"};
+        double      fontSize{11};
+        GdkRGBA     lineColor{0, 0, 0, 1};
+
+        /** The colour the headless render methods fill the ruler with before drawing it. */
+        GdkRGBA     backgroundColor{1, 1, 1, 1};
+    };
+
+    /** The range, dimensions and intervals a ruler is drawn for. */
+    struct Geometry
+    {
+        Orientation orientation{HORIZONTAL};
+
+        // The range to be displayed.
+        double lower{};
+        double upper{};
+
+        // The width and height of the ruler in pixels.
+        int width{};
+        int height{};
+
+        /** The interval between major ticks. */
+        double majorInterval{};
+
+        /** The space between major ticks when drawn. */
+        int majorTickSpacing{};
+
+        /** The number of decimals of the labels, see RulerCalculations::labelDecimals(). */
+        int labelDecimals{};
+
+        /**
+         * Returns the size of the ruler along its orientation in pixels.
+         * @return The width of a horizontal ruler, or the height of a vertical one.
+         */
+        [[nodiscard]] int length() const;
+
+        /**
+         * Returns the length of the major tick lines in pixels.
+         * @return The length of the major tick lines in pixels.
+         */
+        [[nodiscard]] double majorTickLength() const;
+    };
+
+    /** Counts of what a renderer has drawn. Only collected if SCROOMRULER_STATS is defined. */
+    struct Counts
+    {
+        /** The number of times the ticks of a strip of the ruler were laid out. */
+        uint64_t tickLayouts{};
+
+        /** The number of tick lines drawn. */
+        uint64_t ticks{};
+
+        /** The number of tick labels drawn. */
+        uint64_t labels{};
+
+        /** The number of times a path was stroked. */
+        uint64_t strokes{};
+    };
+
+    /** A ruler to render into a surface of its own, as part of a batch. */
+    struct Tile
+    {
+        /** The surface to draw to. Must not be shared with another tile of the same batch. */
+        cairo_surface_t *surface{};
+
+        Orientation orientation{HORIZONTAL};
+
+        // The range to be displayed.
+        double lower{};
+        double upper{};
+
+        // The width and height of the ruler in pixels.
+        int width{};
+        int height{};
+    };
+
+    /** Calculates the interval between major ticks for a tick policy, see RulerCalculations::calculateInterval(). */
+    using IntervalFunction = double (*)(double lower, double upper, double allocatedSize, double labelSpace);
+
+    /**
+     * A tick policy chosen at runtime, see tickpolicies.hh. The policies themselves are types,
+     * so a renderer holds the parts of one that it needs: how it chooses the interval between
+     * major ticks, and how it divides the space between them.
+     */
+    struct TickPolicy
+    {
+        /** Calculates the interval between major ticks. Every policy has a function of its own. */
+        IntervalFunction calculateInterval{};
+
+        /** How the space between major ticks is divided into sub-ticks. */
+        TickLayout::Subdivision subdivision;
+
+        /**
+         * Returns the runtime form of a tick policy.
+         * @tparam Policy The tick policy, such as DecimalTicks or TimeTicks.
+         * @return The tick policy.
+         */
+        template <typename Policy>
+        static TickPolicy of()
+        {
+            return TickPolicy{&RulerCalculations::calculateInterval<Policy>,
+                              TickLayout::Subdivision::of<Policy>(MIN_SPACE_SUBTICKS, LINE_MULTIPLIER)};
+        }
+    };
+
+    /**
+     * The tick policy of a ruler unless another one is set. Each space between major ticks is split into
+     * 5 smaller segments and those segments are split into 2. (Assuming there's enough space.)
+     */
+    using DefaultTicks = DecimalTicks;
+
+    /**
+     * Cairo integer coordinates map to points halfway between pixels.
+     * Therefore, if we offset coordinates by 0.5 in the appropriate
+     * direction, we can draw clear lines.
+     */
+    static constexpr double LINE_COORD_OFFSET{0.5};
+
+    /** The minimum space between sub-ticks. */
+    static constexpr int MIN_SPACE_SUBTICKS{5};
+
+    /** Offset of tick label from the tick line in pixels. */
+    static constexpr double LABEL_OFFSET{4};
+
+    /** Alignment of tick label along the tick line as a fraction of line height. */
+    static constexpr double LABEL_ALIGN{0.7};
+
+    /** The length of a tick one "level" down, as a fraction of the line length of the ticks one level up. */
+    static constexpr double LINE_MULTIPLIER{0.6};
+
+    static constexpr double LINE_WIDTH{1};
+
+    /** Length of the major tick lines as a fraction of the width/height. */
+    static constexpr double MAJOR_TICK_LENGTH{0.8};
+
+    /** Half the width of the marker along the ruler in pixels. */
+    static constexpr double MARKER_HALF_WIDTH{4};
+
+    /** Length of the marker as a fraction of the width/height. */
+    static constexpr double MARKER_LENGTH{0.4};
+
+    /**
+     * Creates a renderer that draws rulers in the default style.
+     */
+    RulerRenderer();
+
+    /**
+     * Creates a renderer.
+     * @param newStyle The font and colours to draw rulers with.
+     * @param newTickPolicy The tick policy to draw rulers with.
+     */
+    explicit RulerRenderer(Style newStyle, TickPolicy newTickPolicy = TickPolicy::of<DefaultTicks>());
+
+    /**
+     * Calculates the interval between major ticks for a range, such that the labels of the major ticks fit between them.
+     * The widths of the labels are estimated from their digits and the metrics of the font, so no text is measured.
+     * @param lower Lower limit of the ruler range.
+     * @param upper Upper limit of the ruler range.
+     * @param drawAreaSize The length of the ruler in pixels.
+     * @return The interval between major ticks, or -1 if the given range or size is invalid.
+     */
+    double majorInterval(double lower, double upper, double drawAreaSize);
+
+    /**
+     * Estimates the space the longest label of a range needs. Those are the labels at either end of the range,
+     * including the label of the tick just before it. Only those two labels are formatted.
+     * @param lower Lower limit of the ruler range.
+     * @param upper Upper limit of the ruler range.
+     * @param interval The interval between major ticks. Must be positive.
+     * @param decimals The number of decimals of the labels, see RulerCalculations::labelDecimals().
+     * @return The larger of the estimated advances of both labels in pixels.
+     */
+    double labelSpace(double lower, double upper, double interval, int decimals);
+
+    /**
+     * Calculates the geometry of a ruler, choosing the interval between major ticks for its range and size.
+     * @param orientation The orientation of the ruler.
+     * @param lower Lower limit of the ruler range.
+     * @param upper Upper limit of the ruler range.
+     * @param width The width of the ruler in pixels.
+     * @param height The height of the ruler in pixels.
+     * @return The geometry of the ruler.
+     */
+    Geometry geometry(Orientation orientation, double lower, double upper, int width, int height);
+
+    /**
+     * Returns the style rulers are drawn with.
+     * @return The style rulers are drawn with.
+     */
+    [[nodiscard]] const Style &getStyle() const;
+
+    /**
+     * Sets the tick policy rulers are drawn with. Geometries calculated before keep the interval of the old policy.
+     * @param newTickPolicy The tick policy to draw rulers with.
+     */
+    void setTickPolicy(TickPolicy newTickPolicy);
+
+    /**
+     * Returns the tick policy rulers are drawn with.
+     * @return The tick policy rulers are drawn with.
+     */
+    [[nodiscard]] const TickPolicy &getTickPolicy() const;
+
+    /**
+     * Draws a complete ruler to a Cairo context: the background, the borders, the ticks and their labels.
+     * The ruler covers the rectangle from the origin of \p cr to \p width, \p height.
+     * @param cr Cairo context to draw to.
+     * @param orientation The orientation of the ruler.
+     * @param lower Lower limit of the ruler range.
+     * @param upper Upper limit of the ruler range.
+     * @param width The width of the ruler in pixels.
+     * @param height The height of the ruler in pixels.
+     */
+    void render(cairo_t *cr, Orientation orientation, double lower, double upper, int width, int height);
+
+    /**
+     * Draws a complete ruler to a Cairo surface. See render(cairo_t*, Orientation, double, double, int, int).
+     * @param surface Cairo surface to draw to.
+     * @param orientation The orientation of the ruler.
+     * @param lower Lower limit of the ruler range.
+     * @param upper Upper limit of the ruler range.
+     * @param width The width of the ruler in pixels.
+     * @param height The height of the ruler in pixels.
+     */
+    void render(cairo_surface_t *surface, Orientation orientation, double lower, double upper, int width, int height);
+
+    /**
+     * Draws the lines along the sides of the ruler, and the thicker border along the edge the ticks hang from.
+     * @param cr Cairo context to draw to.
+     * @param geometry The geometry of the ruler.
+     */
+    void drawBorders(cairo_t *cr, const Geometry &geometry);
+
+    /**
+     * Lays out and draws the ticks and labels that fall within a strip of the ruler.
+     * Drawing outside the strip isn't clipped.
+     * @param cr Cairo context to draw to.
+     * @param geometry The geometry of the ruler.
+     * @param start Start of the strip along the ruler in pixels. Inclusive.
+     * @param end End of the strip along the ruler in pixels. Exclusive.
+     */
+    void drawTicks(cairo_t *cr, const Geometry &geometry, double start, double end);
+
+    /**
+     * Draws the tick marks of a tick layout from left-to-right / bottom-to-top.
+     * The lines are stroked once per level, after which the labels are drawn on top of them.
+     * @param cr Cairo context to draw to.
+     * @param geometry The geometry of the ruler the layout was computed for.
+     * @param layout The layout of the ticks to draw.
+     */
+    void drawTicks(cairo_t *cr, const Geometry &geometry, const TickLayout &layout);
+
+    /**
+     * Draws a marker as a triangle pointing at the edge of the ruler the ticks hang from.
+     * @param cr Cairo context to draw to.
+     * @param geometry The geometry of the ruler.
+     * @param pixelPosition The position of the marker along the ruler in pixels.
+     */
+    void drawMarker(cairo_t *cr, const Geometry &geometry, double pixelPosition);
+
+    /**
+     * Returns the label cache, set up for the style of the renderer and the device scale of the target of a Cairo context.
+     * @param cr Cairo context the labels will be drawn to.
+     * @return The label cache.
+     */
+    LabelCache &labelCacheFor(cairo_t *cr);
+
+    /**
+     * Enables or disables caching of the tick labels. Enabled by default.
+     * @param enabled True to draw labels from the cache, false to render every label with Cairo directly.
+     */
+    void setLabelCacheEnabled(bool enabled);
+
+    /**
+     * Enables or disables composing numeric tick labels from a glyph atlas. Disabled by default.
+     * Only has an effect while the label cache is enabled.
+     * @param enabled True to compose numeric labels from the glyph atlas.
+     */
+    void setGlyphAtlasEnabled(bool enabled);
+
+    /**
+     * Sets the Pango context the tick labels are laid out in, such as the context of a widget.
+     * The context must only be used on the thread the renderer draws on.
+     * @param context The Pango context, or null to lay out labels in the font of the style with Cairo's toy text API.
+     * @return True if the labels will be laid out again, because the context or its font has changed.
+     */
+    bool setPangoContext(PangoContext *context);
+
+    /**
+     * Returns the statistics of the label cache.
+     * @return The statistics of the label cache.
+     */
+    [[nodiscard]] const LabelCache::Stats &getLabelCacheStats() const;
+
+    /**
+     * Returns the counts of what was drawn since the renderer was created or the counts were reset.
+     * All counts are zero unless SCROOMRULER_STATS is defined.
+     * @return The counts of what was drawn.
+     */
+    [[nodiscard]] const Counts &getCounts() const;
+
+    /**
+     * Resets the counts of what was drawn, and the statistics of the label cache, to zero.
+     */
+    void resetCounts();
+
+private:
+    Style style;
+
+    TickPolicy tickPolicy;
+
+    /** Cache of the extents and rendered surfaces of the tick labels. */
+    LabelCache labelCache;
+
+    /** The positions of the ticks in the strip that is being drawn. */
+    TickLayout tickLayout{tickPolicy.subdivision};
+
+    Counts counts;
+
+    // Axis policies, which map positions along and across the ruler to x- and y-coordinates.
+    // The tick rendering is specialised for each of them, so it doesn't check the orientation per tick.
+    struct HorizontalAxis;
+    struct VerticalAxis;
+
+    /**
+     * Draws the tick marks of a tick layout for one orientation.
+     * @tparam Axis The axis policy of the ruler's orientation.
+     * @param cr Cairo context to draw to.
+     * @param geometry The geometry of the ruler.
+     * @param layout The layout of the ticks to draw.
+     */
+    template <typename Axis>
+    void drawTicks(cairo_t *cr, const Geometry &geometry, const TickLayout &layout);
+
+    /**
+     * Draws the marker for one orientation.
+     * @tparam Axis The axis policy of the ruler's orientation.
+     * @param cr Cairo context to draw to.
+     * @param geometry The geometry of the ruler.
+     * @param pixelPosition The position of the marker along the ruler in pixels.
+     */
+    template <typename Axis>
+    void drawMarker(cairo_t *cr, const Geometry &geometry, double pixelPosition);
+
+    /**
+     * Adds the line of a single tick to the current path.
+     * @tparam Axis The axis policy of the ruler's orientation.
+     * @param cr Cairo context to add the line to.
+     * @param geometry The geometry of the ruler.
+     * @param linePosition The position of the line along the ruler.
+     * @param lineLength Length of the line in pixels.
+     * @return True if the line was added, false if it lies outside the drawing area.
+     */
+    template <typename Axis>
+    bool addTickLine(cairo_t *cr, const Geometry &geometry, double linePosition, double lineLength);
+
+    /**
+     * Draws the label of a major tick to the right/top of the tick line.
+     * @tparam Axis The axis policy of the ruler's orientation.
+     * @param cr Cairo context to draw to.
+     * @param geometry The geometry of the ruler.
+     * @param linePosition The position of the tick line along the ruler.
+     * @param lineLength Length of the tick line in pixels.
+     * @param label The label to draw. Must be null-terminated.
+     */
+    template <typename Axis>
+    void drawLabel(cairo_t *cr, const Geometry &geometry, double linePosition, double lineLength, const char *label);
+};
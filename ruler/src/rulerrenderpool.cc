@@ -0,0 +1,72 @@
+#include "rulerrenderpool.hh"
+
+#include <algorithm>
+#include <utility>
+
+RulerRenderPool::RulerRenderPool(const RulerRenderer::Style &style, unsigned threadCount)
+{
+    if (threadCount == 0) { threadCount = std::max(1U, std::thread::hardware_concurrency()); }
+
+    // Every worker is handed a copy of the style for its own renderer
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; i++) { workers.emplace_back(&RulerRenderPool::run, this, style); }
+}
+
+RulerRenderPool::~RulerRenderPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    batchStarted.notify_all();
+    for (std::thread &worker : workers) { worker.join(); }
+}
+
+void RulerRenderPool::render(const std::vector<RulerRenderer::Tile> &tiles)
+{
+    if (tiles.empty()) { return; }
+
+    std::lock_guard<std::mutex> batchLock(batchMutex);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    batch = &tiles;
+    nextTile = 0;
+    busyWorkers = workers.size();
+    batchNumber++;
+    batchStarted.notify_all();
+
+    batchFinished.wait(lock, [this]() { return busyWorkers == 0; });
+    batch = nullptr;
+}
+
+size_t RulerRenderPool::getThreadCount() const
+{
+    return workers.size();
+}
+
+void RulerRenderPool::run(RulerRenderer::Style style)
+{
+    RulerRenderer renderer{std::move(style)};
+    uint64_t renderedBatch = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        batchStarted.wait(lock, [this, renderedBatch]() { return batchNumber != renderedBatch || stopping; });
+        if (stopping) { break; }
+
+        renderedBatch = batchNumber;
+        const std::vector<RulerRenderer::Tile> &tiles = *batch;
+        lock.unlock();
+
+        for (size_t i = nextTile++; i < tiles.size(); i = nextTile++)
+        {
+            const RulerRenderer::Tile &tile = tiles[i];
+            renderer.render(tile.surface, tile.orientation, tile.lower, tile.upper, tile.width, tile.height);
+        }
+
+        lock.lock();
+        busyWorkers--;
+        if (busyWorkers == 0) { batchFinished.notify_all(); }
+    }
+}
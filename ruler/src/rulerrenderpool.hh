@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rulerrenderer.hh"
+
+/**
+ * This class renders batches of rulers in parallel, on a pool of worker threads. Every worker
+ * has a RulerRenderer of its own, so the fonts and label caches aren't shared between threads,
+ * and stay warm from one batch to the next. The workers take the tiles of a batch one at a time,
+ * so a batch of tiles of different sizes is spread evenly over the workers.
+ */
+class RulerRenderPool
+{
+public:
+    /**
+     * Creates a pool and starts its worker threads.
+     * @param style The font and colours to draw the rulers with.
+     * @param threadCount The number of worker threads, or 0 for one per hardware thread.
+     */
+    explicit RulerRenderPool(const RulerRenderer::Style &style = RulerRenderer::Style{}, unsigned threadCount = 0);
+
+    /** Stops the worker threads. */
+    ~RulerRenderPool();
+    RulerRenderPool(const RulerRenderPool&) = delete;
+    RulerRenderPool(RulerRenderPool&&)      = delete;
+    RulerRenderPool operator=(const RulerRenderPool&) = delete;
+    RulerRenderPool operator=(RulerRenderPool&&) = delete;
+
+    /**
+     * Renders a batch of tiles, and blocks until all of them are done. May be called from any thread.
+     * Batches that are submitted at the same time are rendered one after the other.
+     * @param tiles The tiles to render. Each tile must have a surface of its own.
+     */
+    void render(const std::vector<RulerRenderer::Tile> &tiles);
+
+    /**
+     * Returns the number of worker threads.
+     * @return The number of worker threads.
+     */
+    [[nodiscard]] size_t getThreadCount() const;
+
+private:
+    /** Held while a batch is rendered, so only one batch is handed to the workers at a time. */
+    std::mutex batchMutex;
+
+    // The batch for the workers, guarded by mutex
+    std::mutex                                mutex;
+    std::condition_variable                   batchStarted;
+    std::condition_variable                   batchFinished;
+    const std::vector<RulerRenderer::Tile>   *batch{};
+    uint64_t                                  batchNumber{0};
+    size_t                                    busyWorkers{0};
+    bool                                      stopping{false};
+
+    /** The index of the next tile of the batch that hasn't been taken by a worker. */
+    std::atomic<size_t> nextTile{0};
+
+    std::vector<std::thread> workers;
+
+    /**
+     * The loop of a worker thread. Renders the tiles of every batch until the pool stops.
+     * @param style The font and colours to draw the rulers with.
+     */
+    void run(RulerRenderer::Style style);
+};
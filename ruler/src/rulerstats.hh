@@ -0,0 +1,11 @@
+#pragma once
+
+/**
+ * Statements that only collect statistics are wrapped in RULER_STAT, so that they
+ * compile to nothing unless SCROOMRULER_STATS is defined.
+ */
+#ifdef SCROOMRULER_STATS
+#define RULER_STAT(...) __VA_ARGS__
+#else
+#define RULER_STAT(...)
+#endif
@@ -0,0 +1,109 @@
+#include "sharedtickcache.hh"
+
+#include <functional>
+
+bool SharedTickCache::Key::operator==(const Key &other) const
+{
+    return lower == other.lower && upper == other.upper && width == other.width && height == other.height
+           && orientation == other.orientation && scaleFactor == other.scaleFactor && fontFamily == other.fontFamily
+           && fontSize == other.fontSize && gdk_rgba_equal(&lineColor, &other.lineColor)
+           && glyphAtlas == other.glyphAtlas && tickPolicy == other.tickPolicy;
+}
+
+size_t SharedTickCache::KeyHash::operator()(const Key &key) const
+{
+    // Rulers with the same size and orientation mostly differ in their range, so that is hashed first
+    size_t hash = std::hash<double>{}(key.lower);
+    const auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2); };
+    combine(std::hash<double>{}(key.upper));
+    combine(std::hash<int>{}(key.width));
+    combine(std::hash<int>{}(key.height));
+    combine(std::hash<int>{}(key.orientation));
+    combine(std::hash<int>{}(key.scaleFactor));
+    combine(std::hash<std::string>{}(key.fontFamily));
+    combine(std::hash<double>{}(key.fontSize));
+    return hash;
+}
+
+SharedTickCache &SharedTickCache::instance()
+{
+    static SharedTickCache cache;
+    return cache;
+}
+
+SharedTickCache::~SharedTickCache()
+{
+    clear();
+}
+
+cairo_surface_t *SharedTickCache::lookup(const Key &key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto found = index.find(key);
+    if (found == index.end())
+    {
+        misses++;
+        return nullptr;
+    }
+
+    hits++;
+    entries.splice(entries.begin(), entries, found->second);
+    return cairo_surface_reference(found->second->surface);
+}
+
+bool SharedTickCache::insert(const Key &key, cairo_surface_t *surface)
+{
+    const size_t SURFACE_BYTES = static_cast<size_t>(cairo_image_surface_get_stride(surface)) * cairo_image_surface_get_height(surface);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (SURFACE_BYTES > memoryLimit || index.find(key) != index.end()) { return false; }
+
+    evict(SURFACE_BYTES);
+    entries.push_front(Entry{key, cairo_surface_reference(surface), SURFACE_BYTES});
+    index.emplace(key, entries.begin());
+    bytes += SURFACE_BYTES;
+    return true;
+}
+
+void SharedTickCache::setMemoryLimit(size_t limit)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    memoryLimit = limit;
+    evict(0);
+}
+
+SharedTickCache::Usage SharedTickCache::getUsage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return Usage{entries.size(), bytes, memoryLimit, hits, misses, evictions};
+}
+
+void SharedTickCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (Entry &entry : entries) { cairo_surface_destroy(entry.surface); }
+    entries.clear();
+    index.clear();
+    bytes = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+}
+
+void SharedTickCache::evict(size_t needed)
+{
+    while (!entries.empty() && bytes + needed > memoryLimit)
+    {
+        Entry &oldest = entries.back();
+        bytes -= oldest.bytes;
+        cairo_surface_destroy(oldest.surface);
+        index.erase(oldest.key);
+        entries.pop_back();
+        evictions++;
+    }
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <gtk/gtk.h>
+
+#include "rulerrenderer.hh"
+
+/**
+ * This class shares the rendered ticks and labels of rulers between all rulers in the process.
+ * Rulers that show the same range at the same size, orientation, style and scale factor draw
+ * from one surface, which is laid out and rendered only once. The least recently used surfaces
+ * are released when the cache grows beyond its memory limit.
+ *
+ * The surfaces in the cache must never be drawn to. A ruler that has to change its ticks
+ * renders them to a surface of its own.
+ */
+class SharedTickCache
+{
+public:
+    /** Everything that determines what the ticks of a ruler look like. */
+    struct Key
+    {
+        double                     lower{};
+        double                     upper{};
+        int                        width{};
+        int                        height{};
+        RulerRenderer::Orientation orientation{RulerRenderer::HORIZONTAL};
+        int                        scaleFactor{1};
+        std::string                fontFamily;
+        double                     fontSize{};
+        GdkRGBA                    lineColor{};
+
+        /** Whether the labels were composed from a glyph atlas, which renders them slightly differently. */
+        bool glyphAtlas{};
+
+        /** The tick policy, identified by its interval function. */
+        RulerRenderer::IntervalFunction tickPolicy{};
+
+        bool operator==(const Key &other) const;
+    };
+
+    /** The memory use and effectiveness of the cache. */
+    struct Usage
+    {
+        /** The number of surfaces in the cache. */
+        size_t entries{};
+
+        /** The memory used by the surfaces in the cache in bytes. */
+        size_t bytes{};
+
+        /** The maximum memory used by the surfaces in the cache in bytes. */
+        size_t memoryLimit{};
+
+        /** The number of lookups that found a surface. */
+        uint64_t hits{};
+
+        /** The number of lookups that found no surface. */
+        uint64_t misses{};
+
+        /** The number of surfaces released to stay within the memory limit. */
+        uint64_t evictions{};
+    };
+
+    /** The default maximum memory used by the surfaces in the cache in bytes. */
+    static constexpr size_t DEFAULT_MEMORY_LIMIT{32 << 20};
+
+    /**
+     * Returns the cache shared by all rulers in the process.
+     * @return The shared cache.
+     */
+    static SharedTickCache &instance();
+
+    SharedTickCache() = default;
+    ~SharedTickCache();
+    SharedTickCache(const SharedTickCache&) = delete;
+    SharedTickCache(SharedTickCache&&)      = delete;
+    SharedTickCache operator=(const SharedTickCache&) = delete;
+    SharedTickCache operator=(SharedTickCache&&) = delete;
+
+    /**
+     * Looks up the rendered ticks for a key, and marks them as most recently used.
+     * @param key The properties of the ruler.
+     * @return A new reference to the surface, which must be released by the caller, or null if there is none.
+     */
+    cairo_surface_t *lookup(const Key &key);
+
+    /**
+     * Adds the rendered ticks for a key to the cache, releasing the least recently used surfaces if it grows beyond its
+     * memory limit. The cache takes a reference of its own to the surface, which must not be drawn to afterwards.
+     * @param key The properties of the ruler.
+     * @param surface The rendered ticks. Must be an image surface.
+     * @return True if the surface was added. False if the key is already in the cache, or the surface is larger than the limit.
+     */
+    bool insert(const Key &key, cairo_surface_t *surface);
+
+    /**
+     * Sets the maximum memory used by the surfaces in the cache, releasing the least recently used surfaces if needed.
+     * Surfaces that are released while rulers still draw from them are only freed once those rulers are done with them.
+     * @param limit The maximum memory in bytes.
+     */
+    void setMemoryLimit(size_t limit);
+
+    /**
+     * Returns the memory use and effectiveness of the cache.
+     * @return The memory use and effectiveness of the cache.
+     */
+    [[nodiscard]] Usage getUsage() const;
+
+    /**
+     * Releases all surfaces in the cache, and resets the counts of the usage to zero.
+     */
+    void clear();
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const;
+    };
+
+    struct Entry
+    {
+        Key              key;
+        cairo_surface_t *surface{};
+        size_t           bytes{};
+    };
+
+    /** Guards everything below, so rulers on any thread can use the cache. */
+    mutable std::mutex mutex;
+
+    /** The entries, most recently used first. */
+    std::list<Entry> entries;
+
+    /** The entries by key. */
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+
+    size_t   bytes{0};
+    size_t   memoryLimit{DEFAULT_MEMORY_LIMIT};
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t evictions{0};
+
+    /**
+     * Releases the least recently used surfaces until the cache has room for a number of bytes.
+     * @param needed The number of bytes that have to fit within the limit.
+     */
+    void evict(size_t needed);
+};
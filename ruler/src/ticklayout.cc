@@ -0,0 +1,256 @@
+#include "ticklayout.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "rulercalculations.hh"
+
+TickLayout::TickLayout(Subdivision newSubdivision)
+        : subdivision{std::move(newSubdivision)}
+{
+}
+
+void TickLayout::compute(double lower, double upper, double drawAreaSize, double majorInterval, int majorTickSpacing, double majorTickLength)
+{
+    if (majorInterval <= 0)
+    {
+        clear();
+        return;
+    }
+
+    compute(lower,
+            upper,
+            drawAreaSize,
+            majorInterval,
+            majorTickSpacing,
+            majorTickLength,
+            RulerCalculations::firstTick(lower, majorInterval),
+            upper);
+}
+
+void TickLayout::compute(double lower,
+                         double upper,
+                         double drawAreaSize,
+                         double majorInterval,
+                         int    majorTickSpacing,
+                         double majorTickLength,
+                         double from,
+                         double to)
+{
+    layOut(lower, upper, drawAreaSize, majorInterval, majorTickSpacing, majorTickLength, from, to, 0, drawAreaSize);
+}
+
+void TickLayout::computeVisible(double lower,
+                                double upper,
+                                double drawAreaSize,
+                                double majorInterval,
+                                int    majorTickSpacing,
+                                double majorTickLength,
+                                double windowStart,
+                                double windowEnd)
+{
+    if (upper <= lower || majorInterval <= 0 || drawAreaSize <= 0)
+    {
+        clear();
+        return;
+    }
+
+    // Map the window to the ruler range. A label extends at most one major tick
+    // spacing beyond its tick, so we start and end one interval further out
+    const double SCALE = (upper - lower) / drawAreaSize;
+    const double FROM = RulerCalculations::firstTick(std::max(lower, lower + windowStart * SCALE - majorInterval), majorInterval);
+    const double TO = std::min(upper, lower + windowEnd * SCALE + majorInterval);
+
+    // A line at position p covers the pixels from p to p + 1
+    layOut(lower,
+           upper,
+           drawAreaSize,
+           majorInterval,
+           majorTickSpacing,
+           majorTickLength,
+           FROM,
+           TO,
+           std::max(0.0, windowStart - 1),
+           std::min(drawAreaSize, windowEnd));
+}
+
+void TickLayout::layOut(double lower,
+                        double upper,
+                        double drawAreaSize,
+                        double majorInterval,
+                        int    majorTickSpacing,
+                        double majorTickLength,
+                        double from,
+                        double to,
+                        double visibleStart,
+                        double visibleEnd)
+{
+    clear();
+
+    if (upper <= lower || majorInterval <= 0 || to <= from) { return; }
+
+    // Find the number of sub-tick levels that have enough space, and the
+    // number of segments the space between two major ticks is split into
+    levelCount = 1;
+    int segmentsPerMajor = 1;
+    double spacing = majorTickSpacing;
+    for (int segments : subdivision.segments)
+    {
+        spacing /= segments;
+        if (spacing < subdivision.minSpacing) { break; }
+
+        segmentsPerMajor *= segments;
+        levelCount++;
+    }
+
+    // Every segment boundary belongs to the highest level it is a boundary of. These
+    // are looked up in the table of the subdivision, or calculated if it has none
+    const int *segmentLevels = nullptr;
+    if (subdivision.levelTable != nullptr)
+    {
+        segmentLevels = subdivision.levelTable + (levelCount - 1) * subdivision.levelTableRow;
+    }
+    else
+    {
+        // We start from the lowest level and overwrite the boundaries of the levels above.
+        subTickLevels.assign(segmentsPerMajor, levelCount - 1);
+        int stride = segmentsPerMajor;
+        for (int level = 1; level < levelCount - 1; level++)
+        {
+            stride /= subdivision.segments.at(level - 1);
+            for (int segment = stride; segment < segmentsPerMajor; segment += stride)
+            {
+                if (subTickLevels[segment] > level) { subTickLevels[segment] = level; }
+            }
+        }
+        subTickLevels[0] = 0;
+        segmentLevels = subTickLevels.data();
+    }
+
+    subTickLengths.resize(levelCount);
+    double lineLength = majorTickLength;
+    for (int level = 0; level < levelCount; level++)
+    {
+        subTickLengths[level] = lineLength;
+        lineLength = subdivision.lengthMultiplier * lineLength;
+    }
+
+    const double SEGMENT_SPACING = static_cast<double>(majorTickSpacing) / segmentsPerMajor;
+
+    const auto MAJOR_TICKS = static_cast<size_t>((to - from) / majorInterval) + 1;
+    positions.reserve(MAJOR_TICKS * segmentsPerMajor);
+    levels.reserve(MAJOR_TICKS * segmentsPerMajor);
+    lengths.reserve(MAJOR_TICKS * segmentsPerMajor);
+    labelIndices.reserve(MAJOR_TICKS * segmentsPerMajor);
+    labelValues.reserve(MAJOR_TICKS);
+
+    // Collect the positions of the major ticks in the ruler range first, so they can be mapped to drawing area
+    // positions in one batch. Each is calculated from the first, so the errors of fractional intervals don't add up
+    for (size_t major = 0; major < MAJOR_TICKS; major++)
+    {
+        const double POSITION = from + static_cast<double>(major) * majorInterval;
+        if (POSITION >= to) { break; }
+        labelValues.push_back(POSITION);
+    }
+    majorPositions.resize(labelValues.size());
+    RulerCalculations::scaleToRange(labelValues.data(), majorPositions.data(), labelValues.size(), lower, upper, 0, drawAreaSize);
+
+    for (size_t major = 0; major < majorPositions.size(); major++)
+    {
+        const double MAJOR_POSITION = majorPositions[major];
+
+        positions.push_back(MAJOR_POSITION);
+        levels.push_back(0);
+        lengths.push_back(majorTickLength);
+        labelIndices.push_back(static_cast<int>(major));
+
+        // Sub-ticks are only laid out within the visible part, so we calculate
+        // the range of segments that lie strictly between its start and end
+        const double FIRST_SEGMENT = floor((visibleStart - MAJOR_POSITION) / SEGMENT_SPACING) + 1;
+        const double END_SEGMENT = ceil((visibleEnd - MAJOR_POSITION) / SEGMENT_SPACING);
+        const int FIRST = static_cast<int>(std::clamp(FIRST_SEGMENT, 1.0, static_cast<double>(segmentsPerMajor)));
+        const int END = static_cast<int>(std::clamp(END_SEGMENT, 1.0, static_cast<double>(segmentsPerMajor)));
+        for (int segment = FIRST; segment < END; segment++)
+        {
+            const double POSITION = MAJOR_POSITION + segment * SEGMENT_SPACING;
+            const int LEVEL = segmentLevels[segment];
+            positions.push_back(POSITION);
+            levels.push_back(LEVEL);
+            lengths.push_back(subTickLengths[LEVEL]);
+            labelIndices.push_back(NO_LABEL);
+        }
+    }
+
+    groupByLevel();
+}
+
+void TickLayout::groupByLevel()
+{
+    // Count the ticks of every level, so each level knows where it starts
+    levelStarts.assign(levelCount + 1, 0);
+    for (int level : levels) { levelStarts[level + 1]++; }
+    for (int level = 0; level < levelCount; level++) { levelStarts[level + 1] += levelStarts[level]; }
+
+    // Then put every tick in the next free place of its level, which keeps them ordered by position
+    levelCursors.assign(levelStarts.begin(), levelStarts.end() - 1);
+    levelOrder.resize(levels.size());
+    for (size_t i = 0; i < levels.size(); i++) { levelOrder[levelCursors[levels[i]]++] = i; }
+}
+
+size_t TickLayout::getTickCount() const
+{
+    return positions.size();
+}
+
+int TickLayout::getLevelCount() const
+{
+    return levelCount;
+}
+
+const std::vector<double> &TickLayout::getPositions() const
+{
+    return positions;
+}
+
+const std::vector<int> &TickLayout::getLevels() const
+{
+    return levels;
+}
+
+const std::vector<double> &TickLayout::getLengths() const
+{
+    return lengths;
+}
+
+const std::vector<int> &TickLayout::getLabelIndices() const
+{
+    return labelIndices;
+}
+
+const std::vector<double> &TickLayout::getLabelValues() const
+{
+    return labelValues;
+}
+
+const std::vector<size_t> &TickLayout::getLevelOrder() const
+{
+    return levelOrder;
+}
+
+const std::vector<size_t> &TickLayout::getLevelStarts() const
+{
+    return levelStarts;
+}
+
+void TickLayout::clear()
+{
+    levelCount = 0;
+    positions.clear();
+    levels.clear();
+    lengths.clear();
+    labelIndices.clear();
+    labelValues.clear();
+    levelOrder.clear();
+    levelStarts.assign(1, 0);
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "tickpolicies.hh"
+
+/**
+ * This class calculates the positions of the ticks of a ruler, independent of how they are drawn.
+ * The ticks are laid out in a single pass over the range and stored as flat arrays, ordered by
+ * position, so the same layout can be used to draw a ruler or gridlines on a canvas.
+ * The arrays are reused by the next layout, so once they have grown large enough, laying out
+ * the ticks doesn't allocate any memory.
+ */
+class TickLayout
+{
+public:
+    /** Describes how the space between major ticks is divided into sub-ticks. */
+    struct Subdivision
+    {
+        /** The number of segments the space between the ticks one level up is split into, per level. */
+        std::vector<int> segments{5, 2};
+
+        /** The minimum space between sub-ticks in pixels. Levels that would have less space are left out. */
+        double minSpacing{5};
+
+        /** The length of a tick one level down, as a fraction of the length of the ticks one level up. */
+        double lengthMultiplier{0.6};
+
+        /**
+         * Optional table with the level of every segment boundary for every number of levels, laid out as
+         * TickTables::SUBTICK_LEVELS. If null, the levels are calculated from the segments by every layout.
+         */
+        const int *levelTable{};
+
+        /** The length of a row of levelTable. */
+        size_t levelTableRow{};
+
+        /**
+         * Returns the subdivision of a tick policy, which uses the policy's compile-time table of levels.
+         * @tparam Policy The tick policy, see tickpolicies.hh.
+         * @param minSpacing The minimum space between sub-ticks in pixels.
+         * @param lengthMultiplier The length of a tick one level down, as a fraction of the length of the ticks one level up.
+         * @return The subdivision of \p Policy.
+         */
+        template <typename Policy>
+        static Subdivision of(double minSpacing, double lengthMultiplier)
+        {
+            using Tables = TickTables<Policy>;
+            return Subdivision{{Policy::SUBTICK_SEGMENTS.begin(), Policy::SUBTICK_SEGMENTS.end()},
+                               minSpacing,
+                               lengthMultiplier,
+                               Tables::SUBTICK_LEVELS.data(),
+                               Tables::MAX_SEGMENTS};
+        }
+    };
+
+    /** Label index of ticks without a label. */
+    static constexpr int NO_LABEL{-1};
+
+    TickLayout() = default;
+
+    /**
+     * Creates a tick layout.
+     * @param newSubdivision How the space between major ticks is divided into sub-ticks.
+     */
+    explicit TickLayout(Subdivision newSubdivision);
+
+    /**
+     * Lays out the ticks for the full range of a ruler.
+     * @param lower Lower limit of the ruler range. Must be strictly less than \p upper.
+     * @param upper Upper limit of the ruler range. Must be strictly greater than \p lower.
+     * @param drawAreaSize The width/height in pixels of the ruler.
+     * @param majorInterval The interval between major ticks in the ruler range.
+     * @param majorTickSpacing The space between major ticks in pixels.
+     * @param majorTickLength The length of the major tick lines in pixels.
+     */
+    void compute(double lower, double upper, double drawAreaSize, double majorInterval, int majorTickSpacing, double majorTickLength);
+
+    /**
+     * Lays out the ticks for the major ticks in [\p from, \p to) and the sub-ticks in between them.
+     * @param lower Lower limit of the ruler range. Must be strictly less than \p upper.
+     * @param upper Upper limit of the ruler range. Must be strictly greater than \p lower.
+     * @param drawAreaSize The width/height in pixels of the ruler.
+     * @param majorInterval The interval between major ticks in the ruler range.
+     * @param majorTickSpacing The space between major ticks in pixels.
+     * @param majorTickLength The length of the major tick lines in pixels.
+     * @param from The position in the ruler range of the first major tick. Must be a multiple of \p majorInterval.
+     * @param to The position in the ruler range to stop at. Exclusive.
+     */
+    void compute(double lower,
+                 double upper,
+                 double drawAreaSize,
+                 double majorInterval,
+                 int    majorTickSpacing,
+                 double majorTickLength,
+                 double from,
+                 double to);
+
+    /**
+     * Lays out only the ticks that are visible in a window of the drawing area. The sub-ticks are limited
+     * to those whose lines touch the window, and the major ticks to those whose labels may reach into it.
+     * Which ticks these are is calculated directly, so the work is proportional to the size of the window.
+     * @param lower Lower limit of the ruler range. Must be strictly less than \p upper.
+     * @param upper Upper limit of the ruler range. Must be strictly greater than \p lower.
+     * @param drawAreaSize The width/height in pixels of the ruler.
+     * @param majorInterval The interval between major ticks in the ruler range.
+     * @param majorTickSpacing The space between major ticks in pixels.
+     * @param majorTickLength The length of the major tick lines in pixels.
+     * @param windowStart Start of the window along the ruler in pixels. Inclusive.
+     * @param windowEnd End of the window along the ruler in pixels. Exclusive.
+     */
+    void computeVisible(double lower,
+                        double upper,
+                        double drawAreaSize,
+                        double majorInterval,
+                        int    majorTickSpacing,
+                        double majorTickLength,
+                        double windowStart,
+                        double windowEnd);
+
+    /**
+     * Returns the number of ticks in the layout.
+     * @return The number of ticks in the layout.
+     */
+    [[nodiscard]] size_t getTickCount() const;
+
+    /**
+     * Returns the number of levels in the layout: the major ticks and each level of sub-ticks that has enough space.
+     * @return The number of levels in the layout.
+     */
+    [[nodiscard]] int getLevelCount() const;
+
+    /**
+     * Returns the positions of the ticks along the ruler in pixels.
+     * Major ticks may lie outside the drawing area, since their labels can still be partly visible.
+     * @return The positions of the ticks along the ruler in pixels.
+     */
+    [[nodiscard]] const std::vector<double> &getPositions() const;
+
+    /**
+     * Returns the levels of the ticks. Major ticks are level 0, sub-ticks one level down are level 1 and so on.
+     * @return The levels of the ticks.
+     */
+    [[nodiscard]] const std::vector<int> &getLevels() const;
+
+    /**
+     * Returns the lengths of the tick lines in pixels.
+     * @return The lengths of the tick lines in pixels.
+     */
+    [[nodiscard]] const std::vector<double> &getLengths() const;
+
+    /**
+     * Returns, for each tick, the index of its label in getLabelValues(), or NO_LABEL if the tick has no label.
+     * @return The label indices of the ticks.
+     */
+    [[nodiscard]] const std::vector<int> &getLabelIndices() const;
+
+    /**
+     * Returns the positions in the ruler range of the labelled ticks.
+     * @return The positions in the ruler range of the labelled ticks.
+     */
+    [[nodiscard]] const std::vector<double> &getLabelValues() const;
+
+    /**
+     * Returns the indices of the ticks grouped by level. Within a level, the ticks are ordered by position.
+     * The ticks of level l are at the indices [getLevelStarts()[l], getLevelStarts()[l + 1]).
+     * @return The indices of the ticks grouped by level.
+     */
+    [[nodiscard]] const std::vector<size_t> &getLevelOrder() const;
+
+    /**
+     * Returns where each level starts in getLevelOrder(), followed by the number of ticks.
+     * @return getLevelCount() + 1 offsets into getLevelOrder().
+     */
+    [[nodiscard]] const std::vector<size_t> &getLevelStarts() const;
+
+private:
+    Subdivision subdivision;
+
+    int levelCount{};
+
+    // The layout, one entry per tick
+    std::vector<double> positions;
+    std::vector<int>    levels;
+    std::vector<double> lengths;
+    std::vector<int>    labelIndices;
+
+    std::vector<double> labelValues;
+
+    // The level of every segment boundary between two major ticks if the subdivision has no
+    // table of levels, and the line length of every level
+    std::vector<int>    subTickLevels;
+    std::vector<double> subTickLengths;
+
+    /** The positions of the major ticks in pixels, in the same order as labelValues. */
+    std::vector<double> majorPositions;
+
+    // The ticks grouped by level, so each level can be drawn without scanning all ticks
+    std::vector<size_t> levelOrder;
+    std::vector<size_t> levelStarts{0};
+    std::vector<size_t> levelCursors;
+
+    /**
+     * Removes all ticks from the layout.
+     */
+    void clear();
+
+    /**
+     * Groups the ticks by level into levelOrder and levelStarts, in a single pass over the ticks.
+     */
+    void groupByLevel();
+
+    /**
+     * Lays out the major ticks in [\p from, \p to) and the sub-ticks in between them that lie strictly
+     * between \p visibleStart and \p visibleEnd. See compute() for the other parameters.
+     * @param from The position in the ruler range of the first major tick. Must be a multiple of \p majorInterval.
+     * @param to The position in the ruler range to stop at. Exclusive.
+     * @param visibleStart The position in pixels the sub-ticks have to lie after.
+     * @param visibleEnd The position in pixels the sub-ticks have to lie before.
+     */
+    void layOut(double lower,
+                double upper,
+                double drawAreaSize,
+                double majorInterval,
+                int    majorTickSpacing,
+                double majorTickLength,
+                double from,
+                double to,
+                double visibleStart,
+                double visibleEnd);
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Tick policies describe which intervals between major ticks a ruler may use, and how the space
+ * between major ticks is divided into sub-ticks. A policy is a type with the following members:
+ *   - MANTISSAS: The intervals within a single cycle, sorted, starting at 1 and all smaller than BASE.
+ *   - BASE: The factor between the intervals of one cycle and the next.
+ *   - SUBTICK_SEGMENTS: The number of segments the space between the ticks one level up is split into, per level.
+ *   - FRACTIONAL_CYCLES: The number of cycles of intervals below 1, for rulers zoomed in beyond one unit per major tick.
+ * The candidate intervals are MANTISSAS[i] * BASE^n for n >= -FRACTIONAL_CYCLES. From 1 up, only whole numbers are
+ * candidates, so a ruler that isn't zoomed in that far is labelled with whole numbers.
+ * TickTables turns a policy into lookup tables at compile time.
+ */
+
+/**
+ * Intervals of 1, 2.5 and 5 times 10^n, split into 5 and then 2 segments. The default policy.
+ * Since 2.5 isn't a whole number, the intervals from 1 up are 1, 5, 10, 25, 50, 100 and so on.
+ * Below 1, intervals of 0.5, 0.25 and 0.1 times 10^-n, down to 10^-12.
+ */
+struct DecimalTicks
+{
+    static constexpr std::array<double, 3> MANTISSAS{1, 2.5, 5};
+    static constexpr double                BASE{10};
+    static constexpr std::array<int, 2>    SUBTICK_SEGMENTS{5, 2};
+    static constexpr int                   FRACTIONAL_CYCLES{12};
+};
+
+/** Intervals of 1, 2 and 5 times 10^n, as on metric rulers. Suited to physical lengths, such as microns. */
+struct MetricTicks
+{
+    static constexpr std::array<double, 3> MANTISSAS{1, 2, 5};
+    static constexpr double                BASE{10};
+    static constexpr std::array<int, 2>    SUBTICK_SEGMENTS{5, 2};
+    static constexpr int                   FRACTIONAL_CYCLES{12};
+};
+
+/** Intervals that are powers of 2, halved at every level, so that ticks line up with power-of-two pixel grids. */
+struct BinaryTicks
+{
+    static constexpr std::array<double, 1> MANTISSAS{1};
+    static constexpr double                BASE{2};
+    static constexpr std::array<int, 4>    SUBTICK_SEGMENTS{2, 2, 2, 2};
+    static constexpr int                   FRACTIONAL_CYCLES{40};
+};
+
+/**
+ * Time in seconds. Intervals of seconds and minutes that divide a minute or an hour,
+ * intervals of hours that divide a day, and the same numbers of days after that.
+ */
+struct TimeTicks
+{
+    static constexpr std::array<double, 14> MANTISSAS{1, 5, 10, 15, 30, 60, 300, 600, 900, 1800, 3600, 10800, 21600, 43200};
+    static constexpr double                 BASE{86400};
+    static constexpr std::array<int, 2>     SUBTICK_SEGMENTS{2, 3};
+    static constexpr int                    FRACTIONAL_CYCLES{0};
+};
+
+/**
+ * Returns whether a non-negative number is a whole number. Unlike floor(), this can be used at compile time.
+ * @param value The number to check. Must be non-negative.
+ * @return True if \p value is a whole number.
+ */
+constexpr bool isWholeNumber(double value)
+{
+    // Every double from 2^53 up is a whole number
+    return value >= 9007199254740992.0 || static_cast<double>(static_cast<int64_t>(value)) == value;
+}
+
+/**
+ * The lookup tables of a tick policy, calculated at compile time.
+ * @tparam Policy The tick policy, see DecimalTicks.
+ */
+template <typename Policy>
+struct TickTables
+{
+    static_assert(Policy::MANTISSAS.size() > 0 && Policy::MANTISSAS[0] == 1, "The first mantissa must be 1");
+    static_assert(Policy::BASE > Policy::MANTISSAS.back(), "All mantissas must be smaller than the base");
+
+    static constexpr size_t MANTISSA_COUNT = Policy::MANTISSAS.size();
+
+    /** The cycle of the smallest candidate interval, which is BASE^FIRST_CYCLE. */
+    static constexpr int FIRST_CYCLE = -Policy::FRACTIONAL_CYCLES;
+
+    /** The largest power of the base that is tabulated. Powers of 10 are exact up to this one. */
+    static constexpr double MAX_TABULATED_POWER{1e22};
+
+    /** The number of cycles of intervals that are tabulated, from FIRST_CYCLE up. */
+    static constexpr size_t CYCLES = []() {
+        size_t cycles = Policy::FRACTIONAL_CYCLES;
+        for (double power = 1; power <= MAX_TABULATED_POWER; power *= Policy::BASE) { cycles++; }
+        return cycles;
+    }();
+
+    /**
+     * The candidate intervals between major ticks, numbered from smallest to largest.
+     * Candidates of 1 and up that aren't whole numbers are -1.
+     */
+    static constexpr std::array<double, CYCLES * MANTISSA_COUNT> CANDIDATES = []() {
+        std::array<double, CYCLES * MANTISSA_COUNT> candidates{};
+        for (size_t cycle = 0; cycle < CYCLES; cycle++)
+        {
+            // Dividing by an exact power of the base gives the nearest double to a fractional interval,
+            // whereas multiplying by an inexact negative power would add the error of that power
+            const int EXPONENT = FIRST_CYCLE + static_cast<int>(cycle);
+            double power = 1;
+            for (int i = 0; i < (EXPONENT < 0 ? -EXPONENT : EXPONENT); i++) { power *= Policy::BASE; }
+
+            for (size_t i = 0; i < MANTISSA_COUNT; i++)
+            {
+                const double INTERVAL = (EXPONENT < 0) ? Policy::MANTISSAS[i] / power : Policy::MANTISSAS[i] * power;
+                candidates[cycle * MANTISSA_COUNT + i] = (EXPONENT < 0 || isWholeNumber(INTERVAL)) ? INTERVAL : -1;
+            }
+        }
+        return candidates;
+    }();
+
+    /** The largest number of levels of ticks: the major ticks and every level of sub-ticks. */
+    static constexpr size_t LEVEL_COUNT = Policy::SUBTICK_SEGMENTS.size() + 1;
+
+    /** For every number of levels, the number of segments the space between two major ticks is split into. */
+    static constexpr std::array<int, LEVEL_COUNT> SEGMENTS_PER_MAJOR = []() {
+        std::array<int, LEVEL_COUNT> segments{};
+        segments[0] = 1;
+        for (size_t level = 1; level < LEVEL_COUNT; level++)
+        {
+            segments[level] = segments[level - 1] * Policy::SUBTICK_SEGMENTS[level - 1];
+        }
+        return segments;
+    }();
+
+    /** The length of a row of SUBTICK_LEVELS. */
+    static constexpr size_t MAX_SEGMENTS = SEGMENTS_PER_MAJOR[LEVEL_COUNT - 1];
+
+    /**
+     * For every number of levels, a row with the level of every segment boundary between two major ticks.
+     * Every segment boundary belongs to the highest level it is a boundary of. The row for n levels starts
+     * at index (n - 1) * MAX_SEGMENTS and has SEGMENTS_PER_MAJOR[n - 1] entries.
+     */
+    static constexpr std::array<int, LEVEL_COUNT * MAX_SEGMENTS> SUBTICK_LEVELS = []() {
+        std::array<int, LEVEL_COUNT * MAX_SEGMENTS> levels{};
+        for (size_t levelCount = 1; levelCount <= LEVEL_COUNT; levelCount++)
+        {
+            const size_t ROW = (levelCount - 1) * MAX_SEGMENTS;
+            const int SEGMENTS = SEGMENTS_PER_MAJOR[levelCount - 1];
+
+            // Start from the lowest level and overwrite the boundaries of the levels above
+            for (int segment = 0; segment < SEGMENTS; segment++)
+            {
+                levels[ROW + segment] = static_cast<int>(levelCount) - 1;
+            }
+            int stride = SEGMENTS;
+            for (size_t level = 1; level + 1 < levelCount; level++)
+            {
+                stride /= Policy::SUBTICK_SEGMENTS[level - 1];
+                for (int segment = stride; segment < SEGMENTS; segment += stride)
+                {
+                    if (levels[ROW + segment] > static_cast<int>(level)) { levels[ROW + segment] = static_cast<int>(level); }
+                }
+            }
+            levels[ROW] = 0;
+        }
+        return levels;
+    }();
+};
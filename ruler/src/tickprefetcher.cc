@@ -0,0 +1,192 @@
+#include "tickprefetcher.hh"
+
+#include <utility>
+
+#include "rulerstats.hh"
+
+bool TickPrefetcher::Key::operator==(const Key &other) const
+{
+    return lower == other.lower && upper == other.upper && drawAreaSize == other.drawAreaSize && majorInterval == other.majorInterval
+           && majorTickSpacing == other.majorTickSpacing && majorTickLength == other.majorTickLength && scaleFactor == other.scaleFactor;
+}
+
+bool TickPrefetcher::Key::operator!=(const Key &other) const
+{
+    return !(*this == other);
+}
+
+TickPrefetcher::TickPrefetcher(TickLayout::Subdivision newSubdivision, std::string newFontFamily, double newFontSize, size_t newMemoryBudget)
+        : subdivision{std::move(newSubdivision)}
+        , fontFamily{std::move(newFontFamily)}
+        , fontSize{newFontSize}
+        , memoryBudget{newMemoryBudget}
+        , worker{&TickPrefetcher::run, this}
+{
+}
+
+TickPrefetcher::~TickPrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    requestChanged.notify_one();
+    worker.join();
+
+    for (auto &slot : published) { release(slot.exchange(nullptr)); }
+}
+
+void TickPrefetcher::request(const std::array<Key, NEIGHBOURS> &keys)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingKeys = keys;
+        requestPending = true;
+    }
+    requestChanged.notify_one();
+}
+
+std::unique_ptr<TickPrefetcher::Result> TickPrefetcher::take(double majorInterval)
+{
+    std::unique_ptr<Result> found;
+    for (auto &slot : published)
+    {
+        Result *result = slot.exchange(nullptr);
+        if (result == nullptr) { continue; }
+
+        if (found == nullptr && result->key.majorInterval == majorInterval)
+        {
+            publishedBytes -= result->bytes;
+            found.reset(result);
+        }
+        else
+        {
+            release(result);
+        }
+    }
+
+#ifdef SCROOMRULER_STATS
+    if (found != nullptr)
+    {
+        hits++;
+    }
+    else
+    {
+        misses++;
+    }
+#endif
+    return found;
+}
+
+void TickPrefetcher::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    workerIdle.wait(lock, [this]() { return !requestPending && !working; });
+}
+
+TickPrefetcher::Stats TickPrefetcher::getStats() const
+{
+    return Stats{requested, publishedCount, dropped, hits, misses};
+}
+
+void TickPrefetcher::resetStats()
+{
+    requested = 0;
+    publishedCount = 0;
+    dropped = 0;
+    hits = 0;
+    misses = 0;
+}
+
+void TickPrefetcher::run()
+{
+    // The labels are measured on a context of the worker's own, since Cairo contexts can't be shared between threads
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+    cairo_t *cr = nullptr;
+    int scaleFactor = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        requestChanged.wait(lock, [this]() { return requestPending || stopping; });
+        if (stopping) { break; }
+
+        const std::array<Key, NEIGHBOURS> KEYS = pendingKeys;
+        requestPending = false;
+        working = true;
+        lock.unlock();
+
+        for (size_t slot = 0; slot < NEIGHBOURS; slot++)
+        {
+            // The extents are measured at the device resolution the labels will be drawn at
+            if (cr == nullptr || KEYS[slot].scaleFactor != scaleFactor)
+            {
+                if (cr != nullptr) { cairo_destroy(cr); }
+                scaleFactor = KEYS[slot].scaleFactor;
+                cairo_surface_set_device_scale(surface, scaleFactor, scaleFactor);
+                cr = cairo_create(surface);
+                cairo_select_font_face(cr, fontFamily.c_str(), CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+                cairo_set_font_size(cr, fontSize);
+            }
+
+            requested++;
+            publish(slot, compute(cr, KEYS[slot]));
+        }
+
+        lock.lock();
+        working = false;
+        if (!requestPending) { workerIdle.notify_all(); }
+    }
+    lock.unlock();
+
+    if (cr != nullptr) { cairo_destroy(cr); }
+    cairo_surface_destroy(surface);
+}
+
+std::unique_ptr<TickPrefetcher::Result> TickPrefetcher::compute(cairo_t *cr, const Key &key) const
+{
+    auto result = std::make_unique<Result>();
+    result->key = key;
+    result->layout = TickLayout{subdivision};
+    result->layout.compute(key.lower, key.upper, key.drawAreaSize, key.majorInterval, key.majorTickSpacing, key.majorTickLength);
+
+    const std::vector<double> &labelValues = result->layout.getLabelValues();
+    const int DECIMALS = RulerCalculations::labelDecimals(key.majorInterval, key.lower, key.upper);
+    result->labels.resize(labelValues.size());
+    result->labelExtents.resize(labelValues.size());
+    for (size_t i = 0; i < labelValues.size(); i++)
+    {
+        cairo_text_extents(cr, RulerCalculations::formatLabel(labelValues[i], result->labels[i], DECIMALS), &result->labelExtents[i]);
+    }
+
+    // Every tick has a position, level, length and label index
+    const size_t BYTES_PER_TICK = 2 * sizeof(double) + 2 * sizeof(int);
+    const size_t BYTES_PER_LABEL = 2 * sizeof(double) + sizeof(RulerCalculations::LabelBuffer) + sizeof(cairo_text_extents_t);
+    result->bytes = sizeof(Result) + result->layout.getTickCount() * BYTES_PER_TICK + labelValues.size() * BYTES_PER_LABEL;
+    return result;
+}
+
+void TickPrefetcher::publish(size_t slot, std::unique_ptr<Result> result)
+{
+    // The layout replaces the one in the slot, so only the rest of the budget has to have room for it
+    Result *previous = published.at(slot).exchange(nullptr);
+    release(previous);
+
+    if (publishedBytes + result->bytes > memoryBudget)
+    {
+        dropped++;
+        return;
+    }
+
+    publishedBytes += result->bytes;
+    publishedCount++;
+    release(published.at(slot).exchange(result.release()));
+}
+
+void TickPrefetcher::release(Result *result)
+{
+    if (result == nullptr) { return; }
+
+    publishedBytes -= result->bytes;
+    delete result; // NOLINT(cppcoreguidelines-owning-memory)
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cairo.h>
+
+#include "rulercalculations.hh"
+#include "ticklayout.hh"
+
+/**
+ * This class precomputes the tick layouts and label extents of the zoom levels next to the current one
+ * on a worker thread, so that a ruler that is zoomed in or out doesn't have to lay out and measure
+ * everything on the GTK main thread. The worker publishes its results through atomic pointers,
+ * so taking a result never waits for the worker. The results are kept within a memory budget.
+ */
+class TickPrefetcher
+{
+public:
+    /** The range, size and intervals a tick layout is computed for. */
+    struct Key
+    {
+        double lower{};
+        double upper{};
+        double drawAreaSize{};
+        double majorInterval{};
+        int    majorTickSpacing{};
+        double majorTickLength{};
+        int    scaleFactor{1};
+
+        bool operator==(const Key &other) const;
+        bool operator!=(const Key &other) const;
+    };
+
+    /** A precomputed tick layout and the extents of its labels. */
+    struct Result
+    {
+        Key key;
+
+        TickLayout layout;
+
+        /** The labels of the layout, in the same order as its label values. */
+        std::vector<RulerCalculations::LabelBuffer> labels;
+
+        /** The extents of the labels, in the same order as the labels. */
+        std::vector<cairo_text_extents_t> labelExtents;
+
+        /** An estimate of the memory used by the result in bytes. */
+        size_t bytes{};
+    };
+
+    /** Statistics of the prefetching. Hits and misses are only collected if SCROOMRULER_STATS is defined. */
+    struct Stats
+    {
+        /** The number of layouts the worker was asked to precompute. */
+        uint64_t requested{};
+
+        /** The number of layouts the worker published. */
+        uint64_t published{};
+
+        /** The number of layouts the worker threw away, because they didn't fit in the memory budget. */
+        uint64_t dropped{};
+
+        /** The number of times a precomputed layout was found for a new interval. */
+        uint64_t hits{};
+
+        /** The number of times no precomputed layout was found for a new interval. */
+        uint64_t misses{};
+    };
+
+    /** The number of layouts that are precomputed per request, one for each neighbouring zoom level. */
+    static constexpr size_t NEIGHBOURS{2};
+
+    /** The default memory budget for the published layouts in bytes. */
+    static constexpr size_t DEFAULT_MEMORY_BUDGET{4 << 20};
+
+    /**
+     * Creates a prefetcher and starts its worker thread.
+     * @param newSubdivision How the space between major ticks is divided into sub-ticks.
+     * @param newFontFamily The font family the labels are measured with.
+     * @param newFontSize The font size the labels are measured with.
+     * @param newMemoryBudget The maximum memory used by the published layouts in bytes.
+     */
+    TickPrefetcher(TickLayout::Subdivision newSubdivision, std::string newFontFamily, double newFontSize, size_t newMemoryBudget = DEFAULT_MEMORY_BUDGET);
+
+    /** Stops the worker thread and releases the published layouts. */
+    ~TickPrefetcher();
+    TickPrefetcher(const TickPrefetcher&) = delete;
+    TickPrefetcher(TickPrefetcher&&)      = delete;
+    TickPrefetcher operator=(const TickPrefetcher&) = delete;
+    TickPrefetcher operator=(TickPrefetcher&&) = delete;
+
+    /**
+     * Asks the worker to precompute the layouts for the neighbouring zoom levels.
+     * Replaces the previous request if the worker hasn't started on it yet.
+     * @param keys The layouts to precompute.
+     */
+    void request(const std::array<Key, NEIGHBOURS> &keys);
+
+    /**
+     * Takes the published layout with a given major interval, if there is one. The other published
+     * layouts are released, since they were predicted for a zoom level that wasn't used. Never blocks.
+     * @param majorInterval The interval between major ticks of the layout.
+     * @return The layout, or null if none was published for \p majorInterval.
+     */
+    std::unique_ptr<Result> take(double majorInterval);
+
+    /**
+     * Blocks until the worker has finished the last request.
+     */
+    void wait();
+
+    /**
+     * Returns the statistics of the prefetching since the prefetcher was created or the statistics were reset.
+     * @return The statistics of the prefetching.
+     */
+    [[nodiscard]] Stats getStats() const;
+
+    /**
+     * Resets the statistics of the prefetching to zero.
+     */
+    void resetStats();
+
+private:
+    TickLayout::Subdivision subdivision;
+    std::string             fontFamily;
+    double                  fontSize;
+    size_t                  memoryBudget;
+
+    // The request for the worker, guarded by mutex
+    std::mutex                   mutex;
+    std::condition_variable      requestChanged;
+    std::condition_variable      workerIdle;
+    std::array<Key, NEIGHBOURS>  pendingKeys{};
+    bool                         requestPending{false};
+    bool                         working{false};
+    bool                         stopping{false};
+
+    /** The published layouts, one per neighbour. Ownership is handed over by exchanging the pointers. */
+    std::array<std::atomic<Result *>, NEIGHBOURS> published{};
+
+    /** The memory used by the published layouts in bytes. */
+    std::atomic<size_t> publishedBytes{0};
+
+    // The statistics. The worker updates them while the main thread reads them
+    std::atomic<uint64_t> requested{0};
+    std::atomic<uint64_t> publishedCount{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+
+    std::thread worker;
+
+    /**
+     * The loop of the worker thread. Waits for requests and computes their layouts until the prefetcher stops.
+     */
+    void run();
+
+    /**
+     * Computes the layout and label extents for a key.
+     * @param cr Cairo context to measure the labels with.
+     * @param key The range, size and intervals to compute the layout for.
+     * @return The computed layout.
+     */
+    [[nodiscard]] std::unique_ptr<Result> compute(cairo_t *cr, const Key &key) const;
+
+    /**
+     * Publishes a layout in a slot, unless it doesn't fit in the memory budget.
+     * Releases the layout that was published in the slot before.
+     * @param slot The slot to publish the layout in.
+     * @param result The layout to publish.
+     */
+    void publish(size_t slot, std::unique_ptr<Result> result);
+
+    /**
+     * Releases a published layout and its share of the memory budget.
+     * @param result The layout to release. May be null.
+     */
+    void release(Result *result);
+};
@@ -4,6 +4,324 @@ namespace utf = boost::unit_test;
 
 #include "../src/ruler.hh"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+/**
+ * The number of times memory was allocated with operator new on this thread. The prefetcher and the
+ * render pool allocate on threads of their own, which don't disturb the count of the test that measures.
+ */
+static thread_local long newCount{};
+
+// Replace the global allocation functions with ones that count the allocations, so tests can check
+// that the ruler's own code doesn't allocate while drawing. Cairo and Pango allocate with malloc, which
+// isn't counted here; the benchmark counts those. The array and aligned forms fall back on these or are unused.
+
+void *operator new(size_t size)
+{
+    newCount++;
+    void *memory = malloc(size > 0 ? size : 1);
+    if (memory == nullptr) { throw std::bad_alloc(); }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t /*size*/) noexcept
+{
+    free(memory);
+}
+
+/**
+ * Allocates a size to a drawing area, which triggers the "size-allocate" signal.
+ * @param drawingArea The drawing area to allocate a size to.
+ * @param width The width to allocate.
+ * @param height The height to allocate.
+ */
+static void allocateSize(GtkWidget *drawingArea, int width, int height)
+{
+    // GTK expects the preferred size to be queried before allocating
+    gint minimum{};
+    gint natural{};
+    gtk_widget_get_preferred_width(drawingArea, &minimum, &natural);
+    gtk_widget_get_preferred_height(drawingArea, &minimum, &natural);
+
+    GtkAllocation allocation{0, 0, width, height};
+    gtk_widget_size_allocate(drawingArea, &allocation);
+}
+
+/**
+ * Renders a drawing area to a new image surface by emitting its "draw" signal.
+ * @param drawingArea The drawing area to render.
+ * @param width The width of the image in logical pixels.
+ * @param height The height of the image in logical pixels.
+ * @param scaleFactor The device scale of the image, as GTK would draw to on a high-resolution display.
+ * @return The rendered image. Must be destroyed by the caller.
+ */
+static cairo_surface_t *renderToImage(GtkWidget *drawingArea, int width, int height, int scaleFactor = 1)
+{
+    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width * scaleFactor, height * scaleFactor);
+    cairo_surface_set_device_scale(image, scaleFactor, scaleFactor);
+    cairo_t *cr = cairo_create(image);
+    gboolean handled = FALSE;
+    g_signal_emit_by_name(drawingArea, "draw", cr, &handled);
+    cairo_destroy(cr);
+    cairo_surface_flush(image);
+    return image;
+}
+
+/**
+ * Renders a drawing area to an image surface by emitting its "draw" signal, with a clip
+ * region as GTK would set up when only part of the widget was invalidated.
+ * @param drawingArea The drawing area to render.
+ * @param image The image to render to.
+ * @param clip The part of the image to render.
+ */
+static void renderClipped(GtkWidget *drawingArea, cairo_surface_t *image, const GdkRectangle &clip)
+{
+    cairo_t *cr = cairo_create(image);
+    cairo_rectangle(cr, clip.x, clip.y, clip.width, clip.height);
+    cairo_clip(cr);
+    gboolean handled = FALSE;
+    g_signal_emit_by_name(drawingArea, "draw", cr, &handled);
+    cairo_destroy(cr);
+    cairo_surface_flush(image);
+}
+
+/**
+ * Checks whether a region of two image surfaces of the same size contains exactly the same pixels.
+ * @param a The first image.
+ * @param b The second image.
+ * @param region The region to compare.
+ * @return True if the pixels of both images within \p region are identical.
+ */
+static bool regionsEqual(cairo_surface_t *a, cairo_surface_t *b, const GdkRectangle &region)
+{
+    const int stride = cairo_image_surface_get_stride(a);
+    const int bytesPerPixel = 4;
+    for (int y = region.y; y < region.y + region.height; y++)
+    {
+        const unsigned char *rowA = cairo_image_surface_get_data(a) + y * stride + region.x * bytesPerPixel;
+        const unsigned char *rowB = cairo_image_surface_get_data(b) + y * stride + region.x * bytesPerPixel;
+        if (memcmp(rowA, rowB, static_cast<size_t>(region.width * bytesPerPixel)) != 0) { return false; }
+    }
+    return true;
+}
+
+/**
+ * Checks whether two image surfaces of the same size contain exactly the same pixels.
+ * @param a The first image.
+ * @param b The second image.
+ * @return True if the pixels of both images are identical.
+ */
+static bool imagesEqual(cairo_surface_t *a, cairo_surface_t *b)
+{
+    const int height = cairo_image_surface_get_height(a);
+    const int stride = cairo_image_surface_get_stride(a);
+    if (height != cairo_image_surface_get_height(b) || stride != cairo_image_surface_get_stride(b)) { return false; }
+
+    return memcmp(cairo_image_surface_get_data(a), cairo_image_surface_get_data(b), static_cast<size_t>(height * stride)) == 0;
+}
+
+/**
+ * Counts the pixels that differ between two images of the same size.
+ * @param a The first image.
+ * @param b The second image.
+ * @return The number of pixels that differ between \p a and \p b.
+ */
+static int differingPixels(cairo_surface_t *a, cairo_surface_t *b)
+{
+    const int width = cairo_image_surface_get_width(a);
+    const int height = cairo_image_surface_get_height(a);
+    const int stride = cairo_image_surface_get_stride(a);
+    const unsigned char *dataA = cairo_image_surface_get_data(a);
+    const unsigned char *dataB = cairo_image_surface_get_data(b);
+
+    int count = 0;
+    for (int y = 0; y < height; y++)
+    {
+        const size_t ROW = static_cast<size_t>(y * stride);
+        for (int x = 0; x < width; x++)
+        {
+            if (memcmp(dataA + ROW + 4 * x, dataB + ROW + 4 * x, 4) != 0) { count++; }
+        }
+    }
+    return count;
+}
+
+/**
+ * Creates a ruler with a drawing area of the given size and range.
+ * @param orientation The orientation of the ruler.
+ * @param width The width of the drawing area.
+ * @param height The height of the drawing area.
+ * @param lower Lower limit of the ruler range.
+ * @param upper Upper limit of the ruler range.
+ * @param drawingArea Set to the created drawing area.
+ * @return The newly created ruler.
+ */
+static Ruler::Ptr createSizedRuler(Ruler::Orientation orientation, int width, int height, double lower, double upper,
+                                   GtkWidget *&drawingArea)
+{
+    gtk_init(nullptr, nullptr);
+    drawingArea = gtk_drawing_area_new();
+    gtk_widget_show(drawingArea);
+    Ruler::Ptr ruler = Ruler::create(orientation, drawingArea);
+    allocateSize(drawingArea, width, height);
+    ruler->setRange(lower, upper);
+    return ruler;
+}
+
+/** Sets up or changes a ruler, given the ruler and its drawing area. */
+using RulerChange = std::function<void(const Ruler::Ptr &ruler, GtkWidget *drawingArea)>;
+
+/**
+ * Checks that a ruler is drawn the same as a ruler that is freshly created for its range and size.
+ * @param orientation The orientation of the ruler.
+ * @param ruler The ruler to check.
+ * @param drawingArea The drawing area of the ruler.
+ * @param setUpFresh Sets up the fresh ruler before it is drawn, for the options it should share with \p ruler. May be empty.
+ * @return True if both renderings are identical.
+ */
+static bool matchesFreshRender(Ruler::Orientation orientation, const Ruler::Ptr &ruler, GtkWidget *drawingArea,
+                               const RulerChange &setUpFresh = {})
+{
+    const int width = gtk_widget_get_allocated_width(drawingArea);
+    const int height = gtk_widget_get_allocated_height(drawingArea);
+
+    GtkWidget *freshArea = nullptr;
+    Ruler::Ptr fresh = createSizedRuler(orientation, width, height, ruler->getLowerLimit(), ruler->getUpperLimit(), freshArea);
+    if (setUpFresh) { setUpFresh(fresh, freshArea); }
+
+    cairo_surface_t *image = renderToImage(drawingArea, width, height);
+    cairo_surface_t *freshImage = renderToImage(freshArea, width, height);
+    const bool equal = imagesEqual(image, freshImage);
+    cairo_surface_destroy(image);
+    cairo_surface_destroy(freshImage);
+    return equal;
+}
+
+/**
+ * Creates and draws a ruler, changes it, and checks that it is then drawn the same as a ruler
+ * that is freshly created for the range and size it ends up with.
+ * @param orientation The orientation of the rulers.
+ * @param width The width of the drawing area.
+ * @param height The height of the drawing area.
+ * @param lower Lower limit of the ruler range before the change.
+ * @param upper Upper limit of the ruler range before the change.
+ * @param change Changes the ruler after it was drawn.
+ * @param setUpFresh Sets up the fresh ruler before it is drawn. May be empty.
+ * @return True if the changed and fresh renderings are identical.
+ */
+static bool changeMatchesFreshRender(Ruler::Orientation orientation, int width, int height, double lower, double upper,
+                                     const RulerChange &change, const RulerChange &setUpFresh = {})
+{
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(orientation, width, height, lower, upper, drawingArea);
+    cairo_surface_destroy(renderToImage(drawingArea, width, height));
+    change(ruler, drawingArea);
+    return matchesFreshRender(orientation, ruler, drawingArea, setUpFresh);
+}
+
+/**
+ * Pans a ruler through a number of steps, rendering after each step, and checks that
+ * the final rendering is identical to that of a freshly created ruler.
+ * @param orientation The orientation of the rulers.
+ * @param width The width of the drawing areas.
+ * @param height The height of the drawing areas.
+ * @param steps The pan distances in ruler units to apply one after another.
+ * @param scroll True to pan with Ruler::scrollBy, false to set the panned range.
+ * @return True if the panned and fresh renderings are identical.
+ */
+static bool panMatchesFreshRender(Ruler::Orientation orientation, int width, int height, const std::vector<double> &steps,
+                                  bool scroll = false)
+{
+    const double LOWER = -250;
+    const double UPPER = 750;
+
+    return changeMatchesFreshRender(orientation, width, height, LOWER, UPPER, [&](const Ruler::Ptr &ruler, GtkWidget *drawingArea) {
+        double offset = 0;
+        for (double step : steps)
+        {
+            offset += step;
+            if (scroll)
+            {
+                ruler->scrollBy(step);
+            }
+            else
+            {
+                ruler->setRange(LOWER + offset, UPPER + offset);
+            }
+            cairo_surface_destroy(renderToImage(drawingArea, width, height));
+        }
+    });
+}
+
+/**
+ * Renders a ruler with and without the label cache and checks that both renderings are identical.
+ * The cached ruler is rendered twice, so that the second rendering draws the labels from the cache.
+ * @param orientation The orientation of the rulers.
+ * @param width The width of the drawing areas.
+ * @param height The height of the drawing areas.
+ * @param lower Lower limit of the ruler range.
+ * @param upper Upper limit of the ruler range.
+ * @return True if the cached and uncached renderings are identical.
+ */
+static bool labelCacheMatchesUncached(Ruler::Orientation orientation, int width, int height, double lower, double upper)
+{
+    return changeMatchesFreshRender(
+      orientation,
+      width,
+      height,
+      lower,
+      upper,
+      [&](const Ruler::Ptr &cached, GtkWidget *cachedArea) {
+          // Force the tick cache to be rendered again, this time from a warm label cache
+          cached->setRange(lower - (upper - lower), upper);
+          cairo_surface_destroy(renderToImage(cachedArea, width, height));
+          cached->setRange(lower, upper);
+      },
+      [](const Ruler::Ptr &uncached, GtkWidget * /*uncachedArea*/) { uncached->setLabelCacheEnabled(false); });
+}
+
+/**
+ * Calculates the interval between major ticks by trying every valid interval from
+ * smallest to largest. Used as a reference for RulerCalculations::calculateInterval.
+ * @param lower Lower limit of the ruler range. Must be strictly less than \p upper.
+ * @param upper Upper limit of the ruler range. Must be strictly greater than \p lower.
+ * @param allocatedSize The allocated width/height in pixels for the ruler. Must be positive.
+ * @return The interval between ticks.
+ */
+static double linearSearchInterval(double lower, double upper, double allocatedSize)
+{
+    // Below 1, the intervals are 1, 2.5 and 5 times 10^-n, divided by exact powers of 10 like the candidates
+    for (double divisor = 1e12; divisor > 1; divisor /= 10)
+    {
+        for (double mantissa : {1.0, 2.5, 5.0})
+        {
+            if (RulerCalculations::intervalPixelSpacing(mantissa / divisor, lower, upper, allocatedSize) >= 80) { return mantissa / divisor; }
+        }
+    }
+
+    const std::array<double, 4> VALID_INTERVALS{1, 5, 10, 25};
+    for (double power = 1;; power *= 10)
+    {
+        for (double valid : VALID_INTERVALS)
+        {
+            if (RulerCalculations::intervalPixelSpacing(valid * power, lower, upper, allocatedSize) >= 80) { return valid * power; }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE(Ruler_Tests)
 
 BOOST_AUTO_TEST_CASE(Ruler_creation_signal_handlers,
@@ -28,15 +346,826 @@ BOOST_AUTO_TEST_CASE(Ruler_creation_signal_handlers,
     BOOST_CHECK(g_signal_handler_find(drawingArea, mask, drawID, 0, nullptr, nullptr, ruler.get()) != 0);
     // Check that a signal handler is connected for the "size-allocate" signal, with a pointer to ruler as data
     BOOST_CHECK(g_signal_handler_find(drawingArea, mask, sizeAllocateID, 0, nullptr, nullptr, ruler.get()) != 0);
+    // Check that a signal handler is connected for changes of the scale factor, with a pointer to ruler as data
+    auto detailMask = static_cast<GSignalMatchType>(G_SIGNAL_MATCH_ID | G_SIGNAL_MATCH_DETAIL | G_SIGNAL_MATCH_DATA);
+    guint notifyID = g_signal_lookup("notify", G_TYPE_OBJECT);
+    BOOST_CHECK(g_signal_handler_find(drawingArea, detailMask, notifyID, g_quark_from_static_string("scale-factor"), nullptr, nullptr, ruler.get()) != 0);
+}
+
+///////////////
+// Testing the tick cache
+
+BOOST_AUTO_TEST_CASE(Ruler_tickCache_pan_horizontal,
+    * utf::description("Tests that panning a horizontal ruler gives the same result as drawing it from scratch"))
+{
+    BOOST_CHECK(panMatchesFreshRender(Ruler::HORIZONTAL, 1000, 30, {7, 13, 120, -45, -3, 1}));
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_tickCache_pan_vertical,
+    * utf::description("Tests that panning a vertical ruler gives the same result as drawing it from scratch"))
+{
+    BOOST_CHECK(panMatchesFreshRender(Ruler::VERTICAL, 30, 1000, {7, 13, 120, -45, -3, 1}));
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_tickCache_pan_beyond_size,
+    * utf::description("Tests that panning further than the size of the ruler gives the same result as drawing it from scratch"))
+{
+    BOOST_CHECK(panMatchesFreshRender(Ruler::HORIZONTAL, 1000, 30, {1500, -2750}));
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_scrollBy_horizontal,
+    * utf::description("Tests that scrolling a horizontal ruler step by step gives the same result as setting the range from scratch"))
+{
+    BOOST_CHECK(panMatchesFreshRender(Ruler::HORIZONTAL, 1000, 30, {7, 13, 120, -45, -3, 1, 0.5, 1500, 0.5, -2750}, true));
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_scrollBy_vertical,
+    * utf::description("Tests that scrolling a vertical ruler step by step gives the same result as setting the range from scratch"))
+{
+    BOOST_CHECK(panMatchesFreshRender(Ruler::VERTICAL, 30, 1000, {7, 13, 120, -45, -3, 1, 0.5, 1500, 0.5, -2750}, true));
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_scrollBy_fractional_steps,
+    * utf::description("Tests that many scrolls of less than a pixel add up to the same result as setting the range from scratch, "
+                       "and only redraw once they add up to a whole pixel"))
+{
+    std::vector<double> steps(160, 0.1);
+    steps.insert(steps.end(), 20, -0.3);
+    steps.insert(steps.end(), 8, 0.375);
+    BOOST_CHECK(panMatchesFreshRender(Ruler::HORIZONTAL, 1000, 30, steps, true));
+    BOOST_CHECK(panMatchesFreshRender(Ruler::VERTICAL, 30, 1000, steps, true));
+
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, 0, 1000, drawingArea);
+    cairo_surface_destroy(renderToImage(drawingArea, 1000, 30));
+    ruler->resetUpdateCounters();
+
+    // The range includes the part that isn't drawn yet, but nothing is queued for it
+    ruler->scrollBy(0.4);
+    BOOST_CHECK_CLOSE(ruler->getLowerLimit(), 0.4, 1e-9);
+    BOOST_CHECK_EQUAL(ruler->getUpdateCounters().queuedPixels, 0);
+
+    // Once the scrolls add up to a pixel, only the strips near the edges are queued
+    ruler->scrollBy(0.4);
+    ruler->scrollBy(0.4);
+    BOOST_CHECK_CLOSE(ruler->getLowerLimit(), 1.2, 1e-9);
+    BOOST_CHECK_GT(ruler->getUpdateCounters().queuedPixels, 0);
+    BOOST_CHECK_LT(ruler->getUpdateCounters().queuedPixels, 1000 / 2);
+    BOOST_CHECK_EQUAL(ruler->getUpdateCounters().scrolls, 1);
+    BOOST_CHECK_EQUAL(ruler->getUpdateCounters().layouts, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_scrollBy_keeps_intervals,
+    * utf::description("Tests that scrolling doesn't calculate the tick intervals again while the labels at the ends need the same space, "
+                       "and only draws the ticks and labels near the edges that were exposed or clipped"))
+{
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(Ruler::HORIZONTAL, 4000, 30, 100, 2100, drawingArea);
+    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 4000, 30);
+    ruler->resetStats();
+    renderClipped(drawingArea, image, GdkRectangle{0, 0, 4000, 30});
+#ifdef SCROOMRULER_STATS
+    const Ruler::Stats FULL = ruler->getStats();
+#endif
+
+    // Every scroll moves the ruler by 6 pixels. The labels at the ends stay "100" and 4 digits
+    ruler->resetUpdateCounters();
+    for (int i = 0; i < 10; i++)
+    {
+        ruler->scrollBy(3);
+        ruler->resetStats();
+        renderClipped(drawingArea, image, GdkRectangle{0, 0, 4000, 30});
+#ifdef SCROOMRULER_STATS
+        // Only the exposed strip and the strips within a major tick spacing of the edges are drawn again
+        const Ruler::Stats STATS = ruler->getStats();
+        BOOST_CHECK_LE(STATS.tickLayouts, 2);
+        BOOST_CHECK_GT(STATS.ticks, 0);
+        BOOST_CHECK_LT(STATS.ticks, FULL.ticks / 4);
+        BOOST_CHECK_LT(STATS.labels, FULL.labels / 4);
+#endif
+    }
+    BOOST_CHECK(ruler->getLowerLimit() == 130);
+    BOOST_CHECK(ruler->getUpperLimit() == 2130);
+    BOOST_CHECK(ruler->getUpdateCounters().updates == 10);
+    BOOST_CHECK(ruler->getUpdateCounters().scrolls == 10);
+    BOOST_CHECK(ruler->getUpdateCounters().layouts == 0);
+
+    // Once the label at the upper end needs another digit, the intervals are calculated again
+    ruler->scrollBy(8000);
+    BOOST_CHECK(ruler->getUpdateCounters().layouts == 1);
+
+    cairo_surface_destroy(image);
+}
+
+///////////////
+// Testing the label cache
+
+BOOST_AUTO_TEST_CASE(Ruler_labelCache_horizontal,
+    * utf::description("Tests that labels drawn from the cache on a horizontal ruler are identical to uncached labels"))
+{
+    BOOST_CHECK(labelCacheMatchesUncached(Ruler::HORIZONTAL, 1000, 30, -123, 278));
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_labelCache_vertical,
+    * utf::description("Tests that labels drawn from the cache on a vertical ruler are identical to uncached labels"))
+{
+    BOOST_CHECK(labelCacheMatchesUncached(Ruler::VERTICAL, 30, 1000, -123, 278));
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_labelCache_fractional_range,
+    * utf::description("Tests that labels drawn from the cache for a fractional range are identical to uncached labels"))
+{
+    BOOST_CHECK(labelCacheMatchesUncached(Ruler::HORIZONTAL, 777, 27, -12.56, 27.82));
+}
+
+///////////////
+// Testing drawing with a clip region
+
+BOOST_AUTO_TEST_CASE(Ruler_clip_partial_draws,
+    * utf::description("Tests that drawing a ruler in parts through clip regions gives the same result as drawing it at once"))
+{
+    GtkWidget *clippedArea = nullptr;
+    Ruler::Ptr clipped = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, -123, 877, clippedArea);
+    GtkWidget *freshArea = nullptr;
+    Ruler::Ptr fresh = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, -123, 877, freshArea);
+    cairo_surface_t *freshImage = renderToImage(freshArea, 1000, 30);
+
+    cairo_surface_t *clippedImage = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+    const GdkRectangle MIDDLE{300, 0, 120, 30};
+    renderClipped(clippedArea, clippedImage, MIDDLE);
+    BOOST_CHECK(regionsEqual(clippedImage, freshImage, MIDDLE));
+
+    // A clip region that doesn't touch the part drawn before
+    const GdkRectangle RIGHT{850, 0, 100, 30};
+    renderClipped(clippedArea, clippedImage, RIGHT);
+    BOOST_CHECK(regionsEqual(clippedImage, freshImage, RIGHT));
+
+    // Panning moves the parts drawn before
+    clipped->setRange(-100, 900);
+    fresh->setRange(-100, 900);
+    cairo_surface_destroy(freshImage);
+    freshImage = renderToImage(freshArea, 1000, 30);
+    const GdkRectangle LEFT{0, 0, 400, 30};
+    renderClipped(clippedArea, clippedImage, LEFT);
+    BOOST_CHECK(regionsEqual(clippedImage, freshImage, LEFT));
+
+    renderClipped(clippedArea, clippedImage, GdkRectangle{0, 0, 1000, 30});
+    BOOST_CHECK(imagesEqual(clippedImage, freshImage));
+
+    cairo_surface_destroy(clippedImage);
+    cairo_surface_destroy(freshImage);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_pan_queues_exposed_strip,
+    * utf::description("Tests that a small pan only queues the strip it brings into view and the labels near the edges, which are enough to draw it"))
+{
+    for (Ruler::Orientation orientation : {Ruler::HORIZONTAL, Ruler::VERTICAL})
+    {
+        const bool HORIZONTAL = orientation == Ruler::HORIZONTAL;
+        const int WIDTH = HORIZONTAL ? 1000 : 30;
+        const int HEIGHT = HORIZONTAL ? 30 : 1000;
+
+        GtkWidget *pannedArea = nullptr;
+        Ruler::Ptr panned = createSizedRuler(orientation, WIDTH, HEIGHT, 0, 1000, pannedArea);
+        cairo_surface_t *before = renderToImage(pannedArea, WIDTH, HEIGHT);
+        panned->resetUpdateCounters();
+
+        // 3 pixels, with major ticks every 100 pixels
+        panned->setRange(3, 1003);
+        const uint64_t QUEUED = panned->getUpdateCounters().queuedPixels;
+        BOOST_CHECK_GT(QUEUED, 0);
+        BOOST_CHECK_LT(QUEUED, 1000 / 2);
+
+        // Move the contents like the window would, and draw the strips within a major tick spacing of either edge
+        cairo_surface_t *pannedImage = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, WIDTH, HEIGHT);
+        cairo_t *cr = cairo_create(pannedImage);
+        cairo_set_source_surface(cr, before, HORIZONTAL ? -3 : 0, HORIZONTAL ? 0 : -3);
+        cairo_paint(cr);
+        cairo_destroy(cr);
+        const int MARGIN = 100 + static_cast<int>(RulerRenderer::LABEL_OFFSET + RulerRenderer::LINE_WIDTH);
+        renderClipped(pannedArea, pannedImage, HORIZONTAL ? GdkRectangle{0, 0, MARGIN, 30} : GdkRectangle{0, 0, 30, MARGIN});
+        renderClipped(pannedArea,
+                      pannedImage,
+                      HORIZONTAL ? GdkRectangle{1000 - MARGIN - 3, 0, MARGIN + 3, 30} : GdkRectangle{0, 1000 - MARGIN - 3, 30, MARGIN + 3});
+
+        GtkWidget *freshArea = nullptr;
+        Ruler::Ptr fresh = createSizedRuler(orientation, WIDTH, HEIGHT, 3, 1003, freshArea);
+        cairo_surface_t *freshImage = renderToImage(freshArea, WIDTH, HEIGHT);
+        BOOST_CHECK(imagesEqual(pannedImage, freshImage));
+
+        // Zooming moves every tick
+        panned->resetUpdateCounters();
+        panned->setRange(0, 500);
+        BOOST_CHECK_EQUAL(panned->getUpdateCounters().queuedPixels, 1000);
+
+        cairo_surface_destroy(before);
+        cairo_surface_destroy(pannedImage);
+        cairo_surface_destroy(freshImage);
+    }
+}
+
+///////////////
+// Testing the marker
+
+BOOST_AUTO_TEST_CASE(Ruler_marker_move_matches_fresh_render,
+    * utf::description("Tests that redrawing only the old and new position of a moved marker gives the same result as drawing a ruler with the marker at once"))
+{
+    for (Ruler::Orientation orientation : {Ruler::HORIZONTAL, Ruler::VERTICAL})
+    {
+        const int WIDTH = (orientation == Ruler::HORIZONTAL) ? 1000 : 30;
+        const int HEIGHT = (orientation == Ruler::HORIZONTAL) ? 30 : 1000;
+
+        GtkWidget *movedArea = nullptr;
+        Ruler::Ptr moved = createSizedRuler(orientation, WIDTH, HEIGHT, -123, 877, movedArea);
+        moved->setMarkerPosition(100);
+        cairo_surface_t *movedImage = renderToImage(movedArea, WIDTH, HEIGHT);
+
+        // The marker moves from pixel 223 to pixel 423
+        moved->setMarkerPosition(300);
+        BOOST_CHECK(moved->getMarkerPosition() == 300);
+        for (int position : {223, 423})
+        {
+            const GdkRectangle CLIP = (orientation == Ruler::HORIZONTAL) ? GdkRectangle{position - 10, 0, 21, HEIGHT}
+                                                                         : GdkRectangle{0, position - 10, WIDTH, 21};
+            renderClipped(movedArea, movedImage, CLIP);
+        }
+
+        GtkWidget *freshArea = nullptr;
+        Ruler::Ptr fresh = createSizedRuler(orientation, WIDTH, HEIGHT, -123, 877, freshArea);
+        fresh->setMarkerPosition(300);
+        cairo_surface_t *freshImage = renderToImage(freshArea, WIDTH, HEIGHT);
+        BOOST_CHECK(imagesEqual(movedImage, freshImage));
+
+        // Hiding the marker leaves just the ticks
+        moved->setMarkerPosition(NAN);
+        BOOST_CHECK(std::isnan(moved->getMarkerPosition()));
+        GtkWidget *unmarkedArea = nullptr;
+        Ruler::Ptr unmarked = createSizedRuler(orientation, WIDTH, HEIGHT, -123, 877, unmarkedArea);
+        cairo_surface_t *hiddenImage = renderToImage(movedArea, WIDTH, HEIGHT);
+        cairo_surface_t *unmarkedImage = renderToImage(unmarkedArea, WIDTH, HEIGHT);
+        BOOST_CHECK(imagesEqual(hiddenImage, unmarkedImage));
+        BOOST_CHECK(!imagesEqual(freshImage, unmarkedImage));
+
+        cairo_surface_destroy(movedImage);
+        cairo_surface_destroy(freshImage);
+        cairo_surface_destroy(hiddenImage);
+        cairo_surface_destroy(unmarkedImage);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_marker_move_draws_from_tick_cache,
+    * utf::description("Tests that moving the marker doesn't lay out or draw any ticks, however many there are, and doesn't allocate"))
+{
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(Ruler::HORIZONTAL, 4000, 30, 0, 100000, drawingArea);
+    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 4000, 30);
+    renderClipped(drawingArea, image, GdkRectangle{0, 0, 4000, 30});
+    ruler->resetStats();
+
+    const long NEW_COUNT = newCount;
+    for (int event = 0; event < 100; event++)
+    {
+        ruler->setMarkerPosition(1000 * event + 500);
+        renderClipped(drawingArea, image, GdkRectangle{40 * event, 0, 21, 30});
+    }
+    BOOST_CHECK_EQUAL(newCount - NEW_COUNT, 0);
+#ifdef SCROOMRULER_STATS
+    BOOST_CHECK_EQUAL(ruler->getStats().draws, 100);
+    BOOST_CHECK_EQUAL(ruler->getStats().tickLayouts, 0);
+    BOOST_CHECK_EQUAL(ruler->getStats().ticks, 0);
+    BOOST_CHECK_EQUAL(ruler->getStats().labels, 0);
+#endif
+
+    cairo_surface_destroy(image);
+}
+
+///////////////
+// Testing zoom transitions
+
+BOOST_AUTO_TEST_CASE(Ruler_zoomTransition_fades_to_fresh_render,
+    * utf::description("Tests that a change of interval is cross-faded from cached layers, and ends with the same result as a fresh ruler"))
+{
+    GtkWidget *fadingArea = nullptr;
+    Ruler::Ptr fading = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, -123, 877, fadingArea);
+    fading->setZoomTransitions(true);
+    cairo_surface_destroy(renderToImage(fadingArea, 1000, 30));
+
+    GtkWidget *freshArea = nullptr;
+    Ruler::Ptr fresh = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, 127, 627, freshArea);
+    cairo_surface_t *freshImage = renderToImage(freshArea, 1000, 30);
+
+    // Zooming in changes the interval from 100 to 50, which starts a transition
+    fading->setRange(127, 627);
+    fading->resetStats();
+    cairo_surface_t *fadingImage = renderToImage(fadingArea, 1000, 30);
+    BOOST_CHECK(!imagesEqual(fadingImage, freshImage));
+    cairo_surface_destroy(fadingImage);
+
+    // Zooming further within the same interval only scales the cached layers
+    fading->setRange(137, 617);
+    cairo_surface_destroy(renderToImage(fadingArea, 1000, 30));
+    fading->setRange(127, 627);
+    cairo_surface_destroy(renderToImage(fadingArea, 1000, 30));
+#ifdef SCROOMRULER_STATS
+    BOOST_CHECK_EQUAL(fading->getStats().zoomTransitions, 1);
+    BOOST_CHECK_EQUAL(fading->getStats().tickLayouts, 1);
+#endif
+
+    // Once the transition is over, the ticks are as sharp as those of a fresh ruler
+    g_usleep(2 * std::chrono::duration_cast<std::chrono::microseconds>(Ruler::ZOOM_TRANSITION_DURATION).count());
+    fadingImage = renderToImage(fadingArea, 1000, 30);
+    BOOST_CHECK(imagesEqual(fadingImage, freshImage));
+
+    cairo_surface_destroy(fadingImage);
+    cairo_surface_destroy(freshImage);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_zoomTransition_disabled_snaps,
+    * utf::description("Tests that disabling zoom transitions during a transition snaps to the new interval"))
+{
+    BOOST_CHECK(changeMatchesFreshRender(Ruler::VERTICAL, 30, 1000, -123, 877, [](const Ruler::Ptr &fading, GtkWidget *fadingArea) {
+        fading->setZoomTransitions(true);
+        fading->setRange(-623, 1377);
+        cairo_surface_destroy(renderToImage(fadingArea, 30, 1000));
+        fading->setZoomTransitions(false);
+    }));
+}
+
+///////////////
+// Testing prefetching
+
+BOOST_AUTO_TEST_CASE(Ruler_prefetch_zoom_same_result,
+    * utf::description("Tests that zooming a ruler that precomputes the neighbouring zoom levels gives the same result as a fresh ruler"))
+{
+    GtkWidget *prefetchingArea = nullptr;
+    Ruler::Ptr prefetching = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, -123, 877, prefetchingArea);
+    prefetching->setPrefetching(true);
+    cairo_surface_destroy(renderToImage(prefetchingArea, 1000, 30));
+
+    // Zoom in and out in steps of 2 around the center, as predicted
+    const std::vector<std::pair<double, double>> RANGES{{127, 627}, {252, 502}, {127, 627}, {-123, 877}, {-623, 1377}};
+    for (const auto &range : RANGES)
+    {
+        prefetching->setRange(range.first, range.second);
+        BOOST_CHECK(matchesFreshRender(Ruler::HORIZONTAL, prefetching, prefetchingArea));
+    }
+
+#ifdef SCROOMRULER_STATS
+    // Every step changed the interval, and whether the worker was done with it or not, that's a hit or a miss
+    BOOST_CHECK_EQUAL(prefetching->getStats().prefetchHits + prefetching->getStats().prefetchMisses, RANGES.size());
+#endif
+    prefetching->setPrefetching(false);
+}
+
+///////////////
+// Testing the shared tick cache
+
+BOOST_AUTO_TEST_CASE(Ruler_sharedTickCache_identical_rulers,
+    * utf::description("Tests that a ruler identical to one that was rendered before draws from its ticks, with the same result"))
+{
+    SharedTickCache::instance().clear();
+    GtkWidget *firstArea = nullptr;
+    Ruler::Ptr first = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, -123, 877, firstArea);
+    first->setTickCacheSharing(true);
+    cairo_surface_t *firstImage = renderToImage(firstArea, 1000, 30);
+    BOOST_CHECK_EQUAL(SharedTickCache::instance().getUsage().entries, 1);
+
+    GtkWidget *secondArea = nullptr;
+    Ruler::Ptr second = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, -123, 877, secondArea);
+    second->setTickCacheSharing(true);
+    second->resetStats();
+    cairo_surface_t *secondImage = renderToImage(secondArea, 1000, 30);
+    BOOST_CHECK(imagesEqual(firstImage, secondImage));
+    BOOST_CHECK_EQUAL(SharedTickCache::instance().getUsage().entries, 1);
+    BOOST_CHECK_EQUAL(SharedTickCache::instance().getUsage().hits, 1);
+#ifdef SCROOMRULER_STATS
+    BOOST_CHECK_EQUAL(second->getStats().sharedTickCacheHits, 1);
+    BOOST_CHECK_EQUAL(second->getStats().tickLayouts, 0);
+    BOOST_CHECK_EQUAL(second->getStats().labels, 0);
+#endif
+
+    cairo_surface_destroy(firstImage);
+    cairo_surface_destroy(secondImage);
+    SharedTickCache::instance().clear();
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_sharedTickCache_pan_leaves_shared_ticks,
+    * utf::description("Tests that panning and zooming a ruler that draws from shared ticks doesn't change them for the other rulers"))
+{
+    SharedTickCache::instance().clear();
+    GtkWidget *firstArea = nullptr;
+    Ruler::Ptr first = createSizedRuler(Ruler::VERTICAL, 30, 1000, -123, 877, firstArea);
+    first->setTickCacheSharing(true);
+    cairo_surface_t *before = renderToImage(firstArea, 30, 1000);
+
+    GtkWidget *secondArea = nullptr;
+    Ruler::Ptr second = createSizedRuler(Ruler::VERTICAL, 30, 1000, -123, 877, secondArea);
+    second->setTickCacheSharing(true);
+    cairo_surface_destroy(renderToImage(secondArea, 30, 1000));
+
+    // A pan copies the shared ticks, a zoom renders them from scratch
+    const std::vector<std::pair<double, double>> RANGES{{-116, 884}, {-1123, 877}, {-123, 877}, {-100, 900}};
+    for (const auto &range : RANGES)
+    {
+        second->setRange(range.first, range.second);
+        BOOST_CHECK(matchesFreshRender(Ruler::VERTICAL, second, secondArea));
+    }
+
+    cairo_surface_t *after = renderToImage(firstArea, 30, 1000);
+    BOOST_CHECK(imagesEqual(before, after));
+
+    cairo_surface_destroy(before);
+    cairo_surface_destroy(after);
+    SharedTickCache::instance().clear();
+}
+
+///////////////
+// Testing the glyph atlas
+
+BOOST_AUTO_TEST_CASE(GlyphAtlas_extents_match_cairo,
+    * utf::description("Tests that the extents of a label composed from the glyph atlas match the extents Cairo measures"))
+{
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 100, 100);
+    cairo_t *cr = cairo_create(surface);
+    cairo_select_font_face(cr, "sans-serif", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, 11);
+
+    GlyphAtlas atlas;
+    for (const char *label : {"0", "-1230", "98765", "0.25", "-4"})
+    {
+        BOOST_CHECK(GlyphAtlas::covers(label));
+        cairo_text_extents_t expected;
+        cairo_text_extents(cr, label, &expected);
+        const cairo_text_extents_t EXTENTS = atlas.getExtents(cr, label);
+        BOOST_CHECK_CLOSE(EXTENTS.x_advance, expected.x_advance, 0.1);
+        BOOST_CHECK_SMALL(EXTENTS.width - expected.width, 1.0);
+        BOOST_CHECK_SMALL(EXTENTS.height - expected.height, 1.0);
+    }
+    BOOST_CHECK(!GlyphAtlas::covers(""));
+    BOOST_CHECK(!GlyphAtlas::covers("1e6"));
+
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_glyphAtlas_close_to_cairo,
+    * utf::description("Tests that rulers with labels composed from the glyph atlas differ from rulers with labels rendered by Cairo in a few pixels only"))
+{
+    for (Ruler::Orientation orientation : {Ruler::HORIZONTAL, Ruler::VERTICAL})
+    {
+        const int WIDTH = (orientation == Ruler::HORIZONTAL) ? 1000 : 30;
+        const int HEIGHT = (orientation == Ruler::HORIZONTAL) ? 30 : 1000;
+
+        GtkWidget *plainArea = nullptr;
+        Ruler::Ptr plain = createSizedRuler(orientation, WIDTH, HEIGHT, -1234.5, 8765.5, plainArea);
+        cairo_surface_t *plainImage = renderToImage(plainArea, WIDTH, HEIGHT);
+
+        GtkWidget *atlasArea = nullptr;
+        Ruler::Ptr atlas = createSizedRuler(orientation, WIDTH, HEIGHT, -1234.5, 8765.5, atlasArea);
+        atlas->setGlyphAtlasEnabled(true);
+        atlas->resetStats();
+        cairo_surface_t *atlasImage = renderToImage(atlasArea, WIDTH, HEIGHT);
+
+        // Labels that are missing or misplaced would differ in far more pixels
+        BOOST_CHECK_LT(differingPixels(plainImage, atlasImage), WIDTH * HEIGHT / 100);
+#ifdef SCROOMRULER_STATS
+        BOOST_CHECK_GT(atlas->getStats().labelCacheHits, 0);
+        BOOST_CHECK_EQUAL(atlas->getStats().labelCacheMisses, 0);
+#endif
+
+        cairo_surface_destroy(plainImage);
+        cairo_surface_destroy(atlasImage);
+    }
+}
+
+///////////////
+// Testing the widget font
+
+/**
+ * Sets the font of a widget through CSS.
+ * @param widget The widget.
+ * @param css The CSS that sets the font.
+ */
+static void setWidgetCss(GtkWidget *widget, const char *css)
+{
+    GtkCssProvider *provider = gtk_css_provider_new();
+    gtk_css_provider_load_from_data(provider, css, -1, nullptr);
+    gtk_style_context_add_provider(gtk_widget_get_style_context(widget), GTK_STYLE_PROVIDER(provider), GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+    g_object_unref(provider);
+
+    // Update the style now, rather than whenever GTK gets around to it
+    g_signal_emit_by_name(widget, "style-updated");
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_widgetFont_follows_style,
+    * utf::description("Tests that labels drawn in the font of the widget are drawn again when the font of the widget changes"))
+{
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, -123, 877, drawingArea);
+    ruler->setWidgetFont(true);
+    cairo_surface_t *before = renderToImage(drawingArea, 1000, 30);
+
+    setWidgetCss(drawingArea, "* { font: 20px serif; }");
+    cairo_surface_t *after = renderToImage(drawingArea, 1000, 30);
+    BOOST_CHECK(!imagesEqual(before, after));
+
+    // A new ruler in the same style draws the same labels
+    BOOST_CHECK(matchesFreshRender(Ruler::HORIZONTAL, ruler, drawingArea, [](const Ruler::Ptr &fresh, GtkWidget *freshArea) {
+        setWidgetCss(freshArea, "* { font: 20px serif; }");
+        fresh->setWidgetFont(true);
+    }));
+
+    cairo_surface_destroy(before);
+    cairo_surface_destroy(after);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_widgetFont_disabled,
+    * utf::description("Tests that labels are drawn in the font of the style again when the font of the widget is disabled"))
+{
+    BOOST_CHECK(changeMatchesFreshRender(Ruler::VERTICAL, 30, 1000, -123, 877, [](const Ruler::Ptr &ruler, GtkWidget *drawingArea) {
+        setWidgetCss(drawingArea, "* { font: 20px serif; }");
+        ruler->setWidgetFont(true);
+        cairo_surface_destroy(renderToImage(drawingArea, 30, 1000));
+        ruler->setWidgetFont(false);
+    }));
+}
+
+///////////////
+// Testing the scale factor
+
+BOOST_AUTO_TEST_CASE(Ruler_scaleFactor_notify_unchanged_keeps_caches,
+    * utf::description("Tests that a scale factor notification without a change of scale factor keeps the rendered ticks"))
+{
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, -123, 877, drawingArea);
+    cairo_surface_t *before = renderToImage(drawingArea, 1000, 30);
+    cairo_surface_t *tickCache = ruler->getTickCache();
+    ruler->resetStats();
+
+    g_object_notify(G_OBJECT(drawingArea), "scale-factor");
+    cairo_surface_t *after = renderToImage(drawingArea, 1000, 30);
+    BOOST_CHECK(ruler->getTickCache() == tickCache);
+    BOOST_CHECK(imagesEqual(before, after));
+#ifdef SCROOMRULER_STATS
+    BOOST_CHECK_EQUAL(ruler->getStats().tickLayouts, 0);
+    BOOST_CHECK_EQUAL(ruler->getStats().labelCacheMisses, 0);
+#endif
+
+    cairo_surface_destroy(before);
+    cairo_surface_destroy(after);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_scaleFactor_cache_at_device_resolution,
+    * utf::description("Tests that the ticks are cached at the scale factor of the ruler, and cached again when it changes"))
+{
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(Ruler::VERTICAL, 30, 1000, -123, 877, drawingArea);
+    cairo_surface_destroy(renderToImage(drawingArea, 30, 1000));
+
+    // Headless widgets always have a scale factor of 1, so the ruler is told to draw for a high-resolution display
+    ruler->setScaleFactor(2);
+    cairo_surface_t *scaled = renderToImage(drawingArea, 30, 1000, 2);
+    double scaleX{};
+    double scaleY{};
+    cairo_surface_get_device_scale(ruler->getTickCache(), &scaleX, &scaleY);
+    BOOST_CHECK_EQUAL(scaleX, 2);
+    BOOST_CHECK_EQUAL(scaleY, 2);
+    BOOST_CHECK_EQUAL(cairo_image_surface_get_height(ruler->getTickCache()), 2000);
+
+    // The same as a ruler that was drawn at scale 2 from the start, in the cache and on screen
+    GtkWidget *freshArea = nullptr;
+    Ruler::Ptr fresh = createSizedRuler(Ruler::VERTICAL, 30, 1000, -123, 877, freshArea);
+    fresh->setScaleFactor(2);
+    cairo_surface_t *freshImage = renderToImage(freshArea, 30, 1000, 2);
+    BOOST_CHECK(imagesEqual(ruler->getTickCache(), fresh->getTickCache()));
+    BOOST_CHECK(imagesEqual(scaled, freshImage));
+
+    // The cached ticks are copied pixel for pixel, so drawing them again gives the same result
+    cairo_surface_t *again = renderToImage(drawingArea, 30, 1000, 2);
+    BOOST_CHECK(imagesEqual(scaled, again));
+
+    // Back at scale 1, the ticks are cached again at the lower resolution
+    ruler->setScaleFactor(1);
+    BOOST_CHECK(ruler->getTickCache() == nullptr);
+    cairo_surface_t *unscaled = renderToImage(drawingArea, 30, 1000);
+    cairo_surface_get_device_scale(ruler->getTickCache(), &scaleX, &scaleY);
+    BOOST_CHECK_EQUAL(scaleX, 1);
+    BOOST_CHECK_EQUAL(cairo_image_surface_get_height(ruler->getTickCache()), 1000);
+
+    GtkWidget *unscaledArea = nullptr;
+    Ruler::Ptr unscaledFresh = createSizedRuler(Ruler::VERTICAL, 30, 1000, -123, 877, unscaledArea);
+    cairo_surface_t *unscaledFreshImage = renderToImage(unscaledArea, 30, 1000);
+    BOOST_CHECK(imagesEqual(unscaled, unscaledFreshImage));
+
+    cairo_surface_destroy(scaled);
+    cairo_surface_destroy(freshImage);
+    cairo_surface_destroy(again);
+    cairo_surface_destroy(unscaled);
+    cairo_surface_destroy(unscaledFreshImage);
+}
+
+///////////////
+// Testing memory allocation while drawing
+
+BOOST_AUTO_TEST_CASE(Ruler_draw_no_allocations_redraw,
+    * utf::description("Tests that drawing a ruler again doesn't allocate any memory"))
+{
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, -123, 877, drawingArea);
+    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+    renderClipped(drawingArea, image, GdkRectangle{0, 0, 1000, 30});
+
+    const long NEW_COUNT = newCount;
+    for (int frame = 0; frame < 10; frame++)
+    {
+        renderClipped(drawingArea, image, GdkRectangle{0, 0, 1000, 30});
+    }
+    BOOST_CHECK_EQUAL(newCount - NEW_COUNT, 0);
+
+    cairo_surface_destroy(image);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_draw_no_allocations_pan_zoom,
+    * utf::description("Tests that panning and zooming a ruler over ranges it has shown before doesn't allocate any memory"))
+{
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(Ruler::VERTICAL, 30, 1000, -123, 877, drawingArea);
+    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 30, 1000);
+
+    // Every tick and label is rendered once in the first pass, which warms up the caches
+    const std::vector<std::pair<double, double>> RANGES{
+      {-123, 877}, {-116, 884}, {-93, 907}, {-40, 960}, {-1123, 877}, {-123, 877}, {-12.5, 27.5}, {-123, 877}};
+    long passNewCount = 0;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        passNewCount = newCount;
+        for (const auto &range : RANGES)
+        {
+            ruler->setRange(range.first, range.second);
+            renderClipped(drawingArea, image, GdkRectangle{0, 0, 30, 1000});
+        }
+    }
+    BOOST_CHECK_EQUAL(newCount - passNewCount, 0);
+
+    cairo_surface_destroy(image);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_draw_no_allocations_fling,
+    * utf::description("Tests that panning a ruler continuously into ranges it has never shown doesn't allocate any memory once the label cache is full"))
+{
+    for (Ruler::Orientation orientation : {Ruler::HORIZONTAL, Ruler::VERTICAL})
+    {
+        const int WIDTH = (orientation == Ruler::HORIZONTAL) ? 1000 : 30;
+        const int HEIGHT = (orientation == Ruler::HORIZONTAL) ? 30 : 1000;
+        GtkWidget *drawingArea = nullptr;
+        Ruler::Ptr ruler = createSizedRuler(orientation, WIDTH, HEIGHT, 100000, 101000, drawingArea);
+        cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, WIDTH, HEIGHT);
+
+        // Every frame exposes 50 pixels, so a new label every other frame. The first pass
+        // fills the label cache, the second only shows labels that were never drawn before.
+        // All labels have 6 digits, so the interval stays the same
+        const int FRAMES = 1000;
+        const double STEP = 50;
+        double lower = 100000;
+        long passNewCount = 0;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            passNewCount = newCount;
+            for (int frame = 0; frame < FRAMES; frame++)
+            {
+                lower += STEP;
+                ruler->setRange(lower, lower + 1000);
+                renderClipped(drawingArea, image, GdkRectangle{0, 0, WIDTH, HEIGHT});
+            }
+        }
+        BOOST_CHECK_EQUAL(newCount - passNewCount, 0);
+
+        cairo_surface_destroy(image);
+    }
+}
+
+///////////////
+// Testing the drawing statistics
+
+#ifdef SCROOMRULER_STATS
+BOOST_AUTO_TEST_CASE(Ruler_stats_counts,
+    * utf::description("Tests that drawing a ruler is counted in its statistics, and that drawing from the caches counts as such"))
+{
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, -123, 877, drawingArea);
+    ruler->resetStats();
+
+    cairo_surface_destroy(renderToImage(drawingArea, 1000, 30));
+    Ruler::Stats stats = ruler->getStats();
+    BOOST_CHECK_EQUAL(stats.draws, 1);
+    BOOST_CHECK_EQUAL(stats.tickLayouts, 1);
+    BOOST_CHECK_GT(stats.ticks, 0);
+    BOOST_CHECK_GT(stats.labels, 0);
+    // The borders and at least the major ticks
+    BOOST_CHECK_GE(stats.strokes, 3);
+    // Every label is rendered the first time it is drawn
+    BOOST_CHECK_EQUAL(stats.labelCacheHits, 0);
+    BOOST_CHECK_EQUAL(stats.labelCacheMisses, stats.labels);
+    BOOST_CHECK(stats.totalDrawTime.count() > 0);
+    BOOST_CHECK(stats.maxDrawTime == stats.totalDrawTime);
+
+    // Nothing changed, so the ticks and labels are drawn from the tick cache
+    cairo_surface_destroy(renderToImage(drawingArea, 1000, 30));
+    Ruler::Stats cached = ruler->getStats();
+    BOOST_CHECK_EQUAL(cached.draws, 2);
+    BOOST_CHECK_EQUAL(cached.tickLayouts, stats.tickLayouts);
+    BOOST_CHECK_EQUAL(cached.labels, stats.labels);
+    BOOST_CHECK(cached.maxDrawTime <= cached.totalDrawTime);
+
+    // Zooming out and back in again renders the ticks again, but with the labels from the label cache
+    ruler->setRange(-1123, 877);
+    cairo_surface_destroy(renderToImage(drawingArea, 1000, 30));
+    ruler->setRange(-123, 877);
+    ruler->resetStats();
+    cairo_surface_destroy(renderToImage(drawingArea, 1000, 30));
+    BOOST_CHECK_EQUAL(ruler->getStats().labelCacheHits, stats.labels);
+    BOOST_CHECK_EQUAL(ruler->getStats().labelCacheMisses, 0);
+
+    ruler->resetStats();
+    stats = ruler->getStats();
+    BOOST_CHECK_EQUAL(stats.draws, 0);
+    BOOST_CHECK_EQUAL(stats.ticks, 0);
+    BOOST_CHECK_EQUAL(stats.labelCacheHits, 0);
+    BOOST_CHECK(stats.totalDrawTime.count() == 0);
+}
+#else
+BOOST_AUTO_TEST_CASE(Ruler_stats_disabled,
+    * utf::description("Tests that no statistics are collected when SCROOMRULER_STATS is not defined"))
+{
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, -123, 877, drawingArea);
+    cairo_surface_destroy(renderToImage(drawingArea, 1000, 30));
+    BOOST_CHECK_EQUAL(ruler->getStats().draws, 0);
+    BOOST_CHECK_EQUAL(ruler->getStats().ticks, 0);
+}
+#endif
+
+///////////////
+// Testing update coalescing
+
+BOOST_AUTO_TEST_CASE(Ruler_updateCoalescing_setRange_collapsed,
+    * utf::description("Tests that several calls to setRange in one frame are collapsed into a single layout"))
+{
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, 0, 1000, drawingArea);
+    ruler->setUpdateCoalescing(true);
+    ruler->resetUpdateCounters();
+
+    for (int i = 1; i <= 10; i++)
+    {
+        ruler->setRange(i, 1000 + 10 * i);
+    }
+    // The latest range is recorded straight away
+    BOOST_CHECK(ruler->getLowerLimit() == 10);
+    BOOST_CHECK(ruler->getUpperLimit() == 1100);
+    // But nothing is calculated until the next frame
+    BOOST_CHECK(ruler->getUpdateCounters().updates == 10);
+    BOOST_CHECK(ruler->getUpdateCounters().collapsed == 9);
+    BOOST_CHECK(ruler->getUpdateCounters().layouts == 0);
+
+    cairo_surface_destroy(renderToImage(drawingArea, 1000, 30));
+    BOOST_CHECK(ruler->getUpdateCounters().layouts == 1);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_updateCoalescing_disabled_layout_per_update,
+    * utf::description("Tests that every call to setRange is calculated straight away when updates aren't coalesced"))
+{
+    GtkWidget *drawingArea = nullptr;
+    Ruler::Ptr ruler = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, 0, 1000, drawingArea);
+    ruler->resetUpdateCounters();
+
+    for (int i = 1; i <= 10; i++)
+    {
+        ruler->setRange(i, 1000 + 10 * i);
+    }
+    BOOST_CHECK(ruler->getUpdateCounters().updates == 10);
+    BOOST_CHECK(ruler->getUpdateCounters().collapsed == 0);
+    BOOST_CHECK(ruler->getUpdateCounters().layouts == 10);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_updateCoalescing_same_result,
+    * utf::description("Tests that a ruler with coalesced updates is drawn the same as one without"))
+{
+    BOOST_CHECK(changeMatchesFreshRender(Ruler::VERTICAL, 30, 600, 0, 1000, [](const Ruler::Ptr &coalesced, GtkWidget *coalescedArea) {
+        coalesced->setUpdateCoalescing(true);
+        coalesced->setRange(-50, 950);
+        coalesced->setRange(-12.5, 333.25);
+        allocateSize(coalescedArea, 30, 700);
+    }));
 }
 
 ///////////////
 // Testing an all-positive range
 
 BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_0_to_10_width_1920px,
-     * utf::description("Tests the interval for a range [0, 10] for a ruler of width 1920px is 1"))
+     * utf::description("Tests the interval for a range [0, 10] for a ruler of width 1920px is 0.5"))
 {
-    BOOST_CHECK(RulerCalculations::calculateInterval(0, 10, 1920) == 1);
+    BOOST_CHECK(RulerCalculations::calculateInterval(0, 10, 1920) == 0.5);
 }
 
 ///////////////
@@ -120,13 +1249,13 @@ BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_negLARGE_to_LARGE_width_1920px,
 BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_0_to_1_width_540px,
      * utf::description("Tests the correct interval is used for range [0, 1] for a ruler of width 540px"))
 {
-    BOOST_CHECK(RulerCalculations::calculateInterval(0, 1, 540) == 1);
+    BOOST_CHECK(RulerCalculations::calculateInterval(0, 1, 540) == 0.25);
 }
 
 BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_0_to_1_width_1920px,
      * utf::description("Tests the correct interval is used for range [0, 1] for a ruler of width 1920px"))
 {
-    BOOST_CHECK(RulerCalculations::calculateInterval(0, 1, 1920) == 1);
+    BOOST_CHECK(RulerCalculations::calculateInterval(0, 1, 1920) == 0.05);
 }
 
 ///////////////
@@ -135,13 +1264,13 @@ BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_0_to_1_width_1920px,
 BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_0_to_1over10_width_540px,
      * utf::description("Tests the correct interval is used for range [0, 0.1] for a ruler of width 540px"))
 {
-    BOOST_CHECK(RulerCalculations::calculateInterval(0, 0.1, 540) == 1);
+    BOOST_CHECK(RulerCalculations::calculateInterval(0, 0.1, 540) == 0.025);
 }
 
 BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_0_to_1over10_width_1920px,
      * utf::description("Tests the correct interval is used for range [0, 0.1] for a ruler of width 1920px"))
 {
-    BOOST_CHECK(RulerCalculations::calculateInterval(0, 0.1, 1920) == 1);
+    BOOST_CHECK(RulerCalculations::calculateInterval(0, 0.1, 1920) == 0.005);
 }
 
 ///////////////
@@ -174,6 +1303,206 @@ BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_invalid_range_lower_greater_than_
     BOOST_CHECK(RulerCalculations::calculateInterval(0, -100, 1920) == -1);
 }
 
+///////////////
+// Testing INVALID size
+
+BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_invalid_size_0px,
+     * utf::description("Tests that -1 is returned for a ruler of width 0px"))
+{
+    BOOST_CHECK(RulerCalculations::calculateInterval(0, 100, 0) == -1);
+}
+
+///////////////
+// Testing ranges larger than an int can hold
+
+BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_0_to_1e15_width_540px,
+     * utf::description("Tests that the interval for range [0, 1e15] for a ruler of width 540px is 2.5e14"))
+{
+    BOOST_CHECK(RulerCalculations::calculateInterval(0, 1e15, 540) == 2.5e14);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_neg3e9_to_3e9_width_1920px,
+     * utf::description("Tests that the interval for range [-3e9, 3e9] for a ruler of width 1920px is 2.5e8"))
+{
+    BOOST_CHECK(RulerCalculations::calculateInterval(-3e9, 3e9, 1920) == 2.5e8);
+}
+
+///////////////
+// Testing the space for labels
+
+BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_label_space,
+     * utf::description("Tests that the interval leaves more space between the major ticks than the labels need"))
+{
+    BOOST_CHECK(RulerCalculations::calculateInterval(0, 1000, 1000, 0) == 100);
+    BOOST_CHECK(RulerCalculations::calculateInterval(0, 1000, 1000, 99.5) == 100);
+    BOOST_CHECK(RulerCalculations::calculateInterval(0, 1000, 1000, 100) == 250);
+    BOOST_CHECK(RulerCalculations::calculateInterval(0, 1000, 1000, 600) == 1000);
+}
+
+///////////////
+// Testing properties of calculateInterval() over a sweep of ranges
+
+BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_sweep_matches_linear_search,
+     * utf::description("Tests that the interval for ranges from 1e-3 up to 1e15 is the same as found by trying every valid interval"))
+{
+    for (double allocatedSize : {1.0, 100.0, 540.0, 1920.0, 16384.0})
+    {
+        for (double range = 1e-3; range <= 1e15; range *= 1.07)
+        {
+            for (double lower : {0.0, -0.37 * range, 12345.678})
+            {
+                const double EXPECTED = linearSearchInterval(lower, lower + range, allocatedSize);
+                const double INTERVAL = RulerCalculations::calculateInterval(lower, lower + range, allocatedSize);
+                BOOST_CHECK_MESSAGE(INTERVAL == EXPECTED,
+                                    "range [" << lower << ", " << lower + range << "] size " << allocatedSize << ": " << INTERVAL
+                                              << " != " << EXPECTED);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_sweep_spacing,
+     * utf::description("Tests that the interval for ranges up to 1e15 gives a spacing of at least 80px, and less than 80px for a 2.5x smaller interval"))
+{
+    for (double allocatedSize : {100.0, 540.0, 1920.0, 16384.0})
+    {
+        for (double range = 1; range <= 1e15; range *= 1.13)
+        {
+            const double INTERVAL = RulerCalculations::calculateInterval(0, range, allocatedSize);
+            BOOST_CHECK(RulerCalculations::intervalPixelSpacing(INTERVAL, 0, range, allocatedSize) >= 80);
+            // If a 2.5 times smaller interval would fit, a smaller valid interval would have been chosen.
+            // This doesn't hold for 5, since the only smaller valid interval is 1
+            if (INTERVAL > 5)
+            {
+                BOOST_CHECK(RulerCalculations::intervalPixelSpacing(INTERVAL / 2.5, 0, range, allocatedSize) < 80);
+            }
+        }
+    }
+}
+
+///////////////
+// Testing the other tick policies
+
+/**
+ * Finds the interval between major ticks of a tick policy by trying every candidate
+ * from smallest to largest. Used as a reference for RulerCalculations::calculateInterval.
+ * @tparam Policy The tick policy.
+ * @param lower Lower limit of the ruler range. Must be strictly less than \p upper.
+ * @param upper Upper limit of the ruler range. Must be strictly greater than \p lower.
+ * @param allocatedSize The allocated width/height in pixels for the ruler. Must be positive.
+ * @return The interval between ticks, or -1 if none of the tabulated candidates fits.
+ */
+template <typename Policy>
+static double linearSearchInterval(double lower, double upper, double allocatedSize)
+{
+    for (double candidate : TickTables<Policy>::CANDIDATES)
+    {
+        if (candidate > 0 && RulerCalculations::intervalPixelSpacing(candidate, lower, upper, allocatedSize) >= 80) { return candidate; }
+    }
+    return -1;
+}
+
+/**
+ * Checks that RulerCalculations::calculateInterval gives the same interval as a linear search for a tick policy,
+ * over ranges from 1 to 1e15 on rulers of 540 and 1920 pixels.
+ * @tparam Policy The tick policy.
+ * @return True if all intervals are the same.
+ */
+template <typename Policy>
+static bool policyMatchesLinearSearch()
+{
+    for (double size : {540.0, 1920.0})
+    {
+        for (double span = 1; span < 1e15; span *= 1.07)
+        {
+            if (RulerCalculations::calculateInterval<Policy>(-span / 3, span - span / 3, size)
+                != linearSearchInterval<Policy>(-span / 3, span - span / 3, size))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_binary_0_to_1000_width_1000px,
+    * utf::description("Tests that binary ticks for range [0, 1000] on 1000px give an interval of 128"))
+{
+    BOOST_CHECK(RulerCalculations::calculateInterval<BinaryTicks>(0, 1000, 1000) == 128);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_metric_0_to_1000_width_1000px,
+    * utf::description("Tests that metric ticks for range [0, 1000] on 1000px give an interval of 100"))
+{
+    BOOST_CHECK(RulerCalculations::calculateInterval<MetricTicks>(0, 1000, 1000) == 100);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_metric_0_to_500_width_1000px,
+    * utf::description("Tests that metric ticks for range [0, 500] on 1000px give an interval of 50, which isn't valid for decimal ticks"))
+{
+    BOOST_CHECK(RulerCalculations::calculateInterval<MetricTicks>(0, 500, 1000) == 50);
+    BOOST_CHECK(RulerCalculations::calculateInterval<DecimalTicks>(0, 500, 1000) == 50);
+    BOOST_CHECK(RulerCalculations::calculateInterval<MetricTicks>(0, 250, 1000) == 20);
+    BOOST_CHECK(RulerCalculations::calculateInterval<DecimalTicks>(0, 250, 1000) == 25);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_time_one_hour_width_1000px,
+    * utf::description("Tests that time ticks for an hour on 1000px give an interval of 5 minutes"))
+{
+    BOOST_CHECK(RulerCalculations::calculateInterval<TimeTicks>(0, 3600, 1000) == 300);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_time_one_week_width_1000px,
+    * utf::description("Tests that time ticks for a week on 1000px give an interval of a day"))
+{
+    BOOST_CHECK(RulerCalculations::calculateInterval<TimeTicks>(0, 7 * 86400, 1000) == 86400);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_intervalCalculation_policies_match_linear_search,
+    * utf::description("Tests that the interval of every tick policy is the smallest candidate that fits, over a sweep of ranges"))
+{
+    BOOST_CHECK(policyMatchesLinearSearch<DecimalTicks>());
+    BOOST_CHECK(policyMatchesLinearSearch<MetricTicks>());
+    BOOST_CHECK(policyMatchesLinearSearch<BinaryTicks>());
+    BOOST_CHECK(policyMatchesLinearSearch<TimeTicks>());
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_tickTables_decimal_candidates,
+    * utf::description("Tests that the decimal candidates are 1, 5, 10 and 25 times 10^n, with 2.5 left out, preceded by 1, 2.5 and 5 times 10^-n"))
+{
+    const auto &CANDIDATES = TickTables<DecimalTicks>::CANDIDATES;
+    BOOST_CHECK(CANDIDATES.at(0) == 1e-12);
+    BOOST_CHECK(CANDIDATES.at(1) == 2.5e-12);
+    BOOST_CHECK(CANDIDATES.at(2) == 5e-12);
+    BOOST_CHECK(CANDIDATES.at(33) == 0.1);
+    BOOST_CHECK(CANDIDATES.at(34) == 0.25);
+    BOOST_CHECK(CANDIDATES.at(35) == 0.5);
+    BOOST_CHECK(CANDIDATES.at(36) == 1);
+    BOOST_CHECK(CANDIDATES.at(37) == -1);
+    BOOST_CHECK(CANDIDATES.at(38) == 5);
+    BOOST_CHECK(CANDIDATES.at(39) == 10);
+    BOOST_CHECK(CANDIDATES.at(40) == 25);
+    BOOST_CHECK(CANDIDATES.at(102) == 1e22);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_tickPolicy_metric,
+    * utf::description("Tests that a ruler given metric ticks after drawing is drawn like one that had them from the start"))
+{
+    GtkWidget *changedArea = nullptr;
+    Ruler::Ptr changed = createSizedRuler(Ruler::HORIZONTAL, 1000, 30, 0, 250, changedArea);
+    cairo_surface_t *decimalImage = renderToImage(changedArea, 1000, 30);
+    changed->setTickPolicy(RulerRenderer::TickPolicy::of<MetricTicks>());
+
+    // Intervals of 20 rather than 25
+    cairo_surface_t *changedImage = renderToImage(changedArea, 1000, 30);
+    BOOST_CHECK(!imagesEqual(changedImage, decimalImage));
+    BOOST_CHECK(matchesFreshRender(Ruler::HORIZONTAL, changed, changedArea, [](const Ruler::Ptr &metric, GtkWidget * /*metricArea*/) {
+        metric->setTickPolicy(RulerRenderer::TickPolicy::of<MetricTicks>());
+    }));
+
+    cairo_surface_destroy(decimalImage);
+    cairo_surface_destroy(changedImage);
+}
 
 ///////////////
 // Testing scaleToRange()
@@ -203,6 +1532,70 @@ BOOST_AUTO_TEST_CASE(Ruler_scaleToRange_src_SMALL__dest_SMALL__x_SMALL,
 }
 
 
+/**
+ * Checks that a kernel of the batch version of scaleToRange() gives bit-identical results
+ * to the single number version, in place and for every number of elements up to \p x's size.
+ * @param kernel The kernel to check.
+ * @param x The numbers to scale.
+ * @return True if all results are bit-identical.
+ */
+static bool kernelMatchesScalar(RulerCalculations::Kernel kernel, const std::vector<double> &x)
+{
+    const double SRC_LOWER = -123.4;
+    const double SRC_UPPER = 877.9;
+    const double DEST_UPPER = 1917;
+
+    std::vector<double> expected(x.size());
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        expected[i] = RulerCalculations::scaleToRange(x[i], SRC_LOWER, SRC_UPPER, 0, DEST_UPPER);
+    }
+
+    // Every count, so the parts that don't fill a whole vector are tested as well
+    for (size_t count = 0; count <= x.size(); count++)
+    {
+        std::vector<double> result(x.begin(), x.begin() + static_cast<std::ptrdiff_t>(count));
+        RulerCalculations::scaleToRange(result.data(), result.data(), count, SRC_LOWER, SRC_UPPER, 0, DEST_UPPER, kernel);
+        if (memcmp(result.data(), expected.data(), count * sizeof(double)) != 0) { return false; }
+    }
+    return true;
+}
+
+/**
+ * Returns numbers to test the kernels of scaleToRange() with. These include numbers that
+ * scale to exactly halfway between two whole numbers and to just below that.
+ * @return The numbers to test with.
+ */
+static std::vector<double> kernelTestNumbers()
+{
+    const double SCALE = 1917 / (877.9 - -123.4);
+    std::vector<double> x{0, -0.0, -123.4, 877.9, 1e300, -1e300, 1e-300, 4.5e15, -4.5e15};
+    for (int i = -40; i <= 40; i++)
+    {
+        x.push_back(-123.4 + (i + 0.5) / SCALE);
+        x.push_back(std::nextafter(-123.4 + (i + 0.5) / SCALE, 0.0));
+        x.push_back(-123.4 + i * 7.31);
+    }
+    return x;
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_scaleToRange_batch_scalar_kernel,
+     * utf::description("Tests that the scalar kernel of the batch scaleToRange gives bit-identical results to the single number version"))
+{
+    BOOST_CHECK(kernelMatchesScalar(RulerCalculations::Kernel::SCALAR, kernelTestNumbers()));
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_scaleToRange_batch_vector_kernels,
+     * utf::description("Tests that the vector kernels of the batch scaleToRange the processor supports give bit-identical results to the single number version"))
+{
+    for (RulerCalculations::Kernel kernel :
+         {RulerCalculations::Kernel::AUTOMATIC, RulerCalculations::Kernel::SSE4_1, RulerCalculations::Kernel::AVX2})
+    {
+        if (!RulerCalculations::kernelSupported(kernel)) { continue; }
+        BOOST_CHECK(kernelMatchesScalar(kernel, kernelTestNumbers()));
+    }
+}
+
 ///////////////
 // Testing intervalPixelSpacing()
 
@@ -350,4 +1743,140 @@ BOOST_AUTO_TEST_CASE(Ruler_firstTick_lowerLimit_neg0p1_interval_50000,
     BOOST_CHECK(RulerCalculations::firstTick(-0.1, 50000) == -50000);
 }
 
+BOOST_AUTO_TEST_CASE(Ruler_firstTick_lowerLimit_neg3e12_interval_2p5e11,
+     * utf::description("Tests that a lower limit of -3e12 and interval 2.5e11 gives first tick position of -3e12"))
+{
+    BOOST_CHECK(RulerCalculations::firstTick(-3e12, 2.5e11) == -3e12);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_firstTick_lowerLimit_4p3e12_interval_1e12,
+     * utf::description("Tests that a lower limit of 4.3e12 and interval 1e12 gives first tick position of 4e12"))
+{
+    BOOST_CHECK(RulerCalculations::firstTick(4.3e12, 1e12) == 4e12);
+}
+
+///////////////
+// Testing formatLabel()
+
+BOOST_AUTO_TEST_CASE(Ruler_formatLabel_matches_to_string,
+     * utf::description("Tests that labels are formatted as the position rounded down, as std::to_string would"))
+{
+    RulerCalculations::LabelBuffer buffer{};
+    for (double value : {0.0, 25.0, -25.0, 0.1, -0.1, 360.0, -123.0, 2.5e11, -3e12, 4.3e12, 1e18, -9.2e18})
+    {
+        BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(value, buffer), std::to_string(static_cast<int64_t>(floor(value))));
+    }
+
+    // Labels of rulers such as [0, 1e20] are beyond the range of a 64-bit integer
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(2.5e19, buffer), "25000000000000000000");
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(-1e22, buffer), "-10000000000000000000000");
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(1e300, buffer), "1e+300");
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_formatLabel_decimals,
+     * utf::description("Tests that labels with decimals are rounded to the nearest label, and keep their leading zeros"))
+{
+    RulerCalculations::LabelBuffer buffer{};
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(0.1 + 0.2, buffer, 1), "0.3");
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(0.25, buffer, 2), "0.25");
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(-0.25, buffer, 2), "-0.25");
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(-1.5, buffer, 1), "-1.5");
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(-0.04, buffer, 1), "0.0");
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(1e-6, buffer, 6), "0.000001");
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(12345.0005, buffer, 4), "12345.0005");
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(7 * 0.1, buffer, 1), "0.7");
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_formatLabel_decimals_left_out_for_large_values,
+     * utf::description("Tests that decimals that don't fit in a 64-bit integer with the whole part are left out"))
+{
+    RulerCalculations::LabelBuffer buffer{};
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(1e14 + 0.5, buffer, 1), "100000000000000.5");
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(1e18, buffer, 3), "1000000000000000000");
+    BOOST_CHECK_EQUAL(RulerCalculations::formatLabel(-9e16, buffer, 15), "-90000000000000000.0");
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_labelDecimals,
+     * utf::description("Tests that the labels of an interval have as many decimals as the interval needs"))
+{
+    BOOST_CHECK_EQUAL(RulerCalculations::labelDecimals(25), 0);
+    BOOST_CHECK_EQUAL(RulerCalculations::labelDecimals(1), 0);
+    BOOST_CHECK_EQUAL(RulerCalculations::labelDecimals(0.5), 1);
+    BOOST_CHECK_EQUAL(RulerCalculations::labelDecimals(0.1), 1);
+    BOOST_CHECK_EQUAL(RulerCalculations::labelDecimals(0.25), 2);
+    BOOST_CHECK_EQUAL(RulerCalculations::labelDecimals(2.5 / 1e6), 7);
+    BOOST_CHECK_EQUAL(RulerCalculations::labelDecimals(1 / 1e12), 12);
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_formatLabel_deep_zoom_labels_differ,
+     * utf::description("Tests that for ranges down to 1e-9, the labels of neighbouring major ticks differ"))
+{
+    RulerCalculations::LabelBuffer buffer{};
+    RulerCalculations::LabelBuffer previous{};
+    for (double range = 1e-9; range <= 10; range *= 1.37)
+    {
+        for (double lower : {0.0, -0.37 * range, 12345.678})
+        {
+            const double INTERVAL = RulerCalculations::calculateInterval(lower, lower + range, 1000);
+            BOOST_REQUIRE(INTERVAL > 0);
+            BOOST_CHECK(RulerCalculations::intervalPixelSpacing(INTERVAL, lower, lower + range, 1000) >= 80);
+
+            const int DECIMALS = RulerCalculations::labelDecimals(INTERVAL, lower, lower + range);
+            const double FIRST = RulerCalculations::firstTick(lower, INTERVAL);
+            RulerCalculations::formatLabel(FIRST, previous, DECIMALS);
+            for (int major = 1; FIRST + major * INTERVAL <= lower + range; major++)
+            {
+                RulerCalculations::formatLabel(FIRST + major * INTERVAL, buffer, DECIMALS);
+                BOOST_CHECK_MESSAGE(std::string(buffer.data()) != previous.data(),
+                                    "range [" << lower << ", " << lower + range << "]: " << buffer.data() << " repeated");
+                previous = buffer;
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_formatLabel_far_from_zero_labels_increase,
+     * utf::description("Tests that for a range of 1e-6 at 1e9 and beyond, the labels are distinct and strictly increasing"))
+{
+    RulerCalculations::LabelBuffer buffer{};
+    for (double lower : {1e9, 1e9 + 0.3e-6, -1e9 - 1e-6, 3.7e9})
+    {
+        const double UPPER = lower + 1e-6;
+        const double INTERVAL = RulerCalculations::calculateInterval(lower, UPPER, 1000);
+        BOOST_REQUIRE(INTERVAL > 0);
+
+        // The interval is limited to what the doubles in the range can resolve
+        const double ULP = std::nextafter(std::max(fabs(lower), fabs(UPPER)), INFINITY) - std::max(fabs(lower), fabs(UPPER));
+        BOOST_CHECK(INTERVAL >= 4 * ULP);
+
+        const int DECIMALS = RulerCalculations::labelDecimals(INTERVAL, lower, UPPER);
+        BOOST_CHECK(pow(10, -DECIMALS) >= ULP);
+
+        // Check a few ticks on both sides of the range, like a ruler that is panned a little
+        const double FIRST = RulerCalculations::firstTick(lower, INTERVAL);
+        std::string previous = RulerCalculations::formatLabel(FIRST - 5 * INTERVAL, buffer, DECIMALS);
+        for (int major = -4; major <= 5; major++)
+        {
+            const std::string LABEL = RulerCalculations::formatLabel(FIRST + major * INTERVAL, buffer, DECIMALS);
+            BOOST_CHECK_MESSAGE(std::stod(LABEL) > std::stod(previous),
+                                "range [" << lower << ", " << UPPER << "]: " << LABEL << " after " << previous);
+            previous = LABEL;
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Ruler_formatLabel_no_allocations,
+     * utf::description("Tests that formatting a label doesn't allocate any memory"))
+{
+    RulerCalculations::LabelBuffer buffer{};
+    const long NEW_COUNT = newCount;
+    for (int i = -1000; i < 1000; i++)
+    {
+        RulerCalculations::formatLabel(i * 1e9, buffer);
+        RulerCalculations::formatLabel(i * 1e17, buffer);
+        RulerCalculations::formatLabel(i * 0.001, buffer, 3);
+    }
+    BOOST_CHECK_EQUAL(newCount - NEW_COUNT, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,442 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+namespace utf = boost::unit_test;
+
+#include "../src/rulerrenderpool.hh"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+/**
+ * Checks whether two image surfaces of the same size contain exactly the same pixels.
+ * @param a The first image.
+ * @param b The second image.
+ * @return True if the pixels of both images are identical.
+ */
+static bool imagesEqual(cairo_surface_t *a, cairo_surface_t *b)
+{
+    const int height = cairo_image_surface_get_height(a);
+    const int stride = cairo_image_surface_get_stride(a);
+    if (height != cairo_image_surface_get_height(b) || stride != cairo_image_surface_get_stride(b)) { return false; }
+
+    return memcmp(cairo_image_surface_get_data(a), cairo_image_surface_get_data(b), static_cast<size_t>(height * stride)) == 0;
+}
+
+/**
+ * Creates tiles of rulers of both orientations and a number of ranges and sizes, each with a new image surface.
+ * @return The tiles. Their surfaces must be destroyed by the caller.
+ */
+static std::vector<RulerRenderer::Tile> createTiles()
+{
+    const std::vector<std::pair<double, double>> RANGES{{0, 100}, {-123, 877}, {-0.5, 0.25}, {1e6, 3e6}, {-1e12, 1e12}};
+    const std::vector<int> LENGTHS{200, 540, 1000};
+
+    std::vector<RulerRenderer::Tile> tiles;
+    for (RulerRenderer::Orientation orientation : {RulerRenderer::HORIZONTAL, RulerRenderer::VERTICAL})
+    {
+        for (const auto &range : RANGES)
+        {
+            for (int length : LENGTHS)
+            {
+                const int WIDTH = (orientation == RulerRenderer::HORIZONTAL) ? length : 30;
+                const int HEIGHT = (orientation == RulerRenderer::HORIZONTAL) ? 30 : length;
+                cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, WIDTH, HEIGHT);
+                tiles.push_back(RulerRenderer::Tile{surface, orientation, range.first, range.second, WIDTH, HEIGHT});
+            }
+        }
+    }
+    return tiles;
+}
+
+/**
+ * Destroys the surfaces of tiles.
+ * @param tiles The tiles to destroy the surfaces of.
+ */
+static void destroyTiles(const std::vector<RulerRenderer::Tile> &tiles)
+{
+    for (const RulerRenderer::Tile &tile : tiles) { cairo_surface_destroy(tile.surface); }
+}
+
+/**
+ * Checks whether the tiles of a batch are identical to rulers rendered one at a time by a single renderer.
+ * @param tiles The rendered tiles.
+ * @return True if every tile is identical to its sequential rendering.
+ */
+static bool tilesMatchSequentialRender(const std::vector<RulerRenderer::Tile> &tiles)
+{
+    RulerRenderer renderer;
+    bool equal = true;
+    for (const RulerRenderer::Tile &tile : tiles)
+    {
+        cairo_surface_t *expected = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, tile.width, tile.height);
+        renderer.render(expected, tile.orientation, tile.lower, tile.upper, tile.width, tile.height);
+        equal = equal && imagesEqual(tile.surface, expected);
+        cairo_surface_destroy(expected);
+    }
+    return equal;
+}
+
+/**
+ * Draws a ruler and a marker the way the renderer did before its tick drawing was specialised per orientation:
+ * with one branch on the orientation for every tick line, label and marker, and the ticks of each level found
+ * by scanning all ticks. It only uses the public parts of the renderer, so it is independent of that specialisation.
+ * @param renderer The renderer whose style, tick policy and label cache are used.
+ * @param surface The surface to draw to.
+ * @param orientation The orientation of the ruler.
+ * @param lower Lower limit of the ruler range.
+ * @param upper Upper limit of the ruler range.
+ * @param width Width of the ruler in pixels.
+ * @param height Height of the ruler in pixels.
+ * @param markerPosition The position of the marker along the ruler in pixels.
+ */
+static void renderPerTickBranches(RulerRenderer &renderer, cairo_surface_t *surface, RulerRenderer::Orientation orientation,
+                                  double lower, double upper, int width, int height, double markerPosition)
+{
+    const RulerRenderer::Geometry GEOMETRY = renderer.geometry(orientation, lower, upper, width, height);
+    const RulerRenderer::Style STYLE;
+    const bool HORIZONTAL = orientation == RulerRenderer::HORIZONTAL;
+    const double DRAW_AREA_SIZE = GEOMETRY.length();
+    const double OFFSET = RulerRenderer::LINE_WIDTH * RulerRenderer::LINE_COORD_OFFSET;
+
+    cairo_t *cr = cairo_create(surface);
+    cairo_save(cr);
+    cairo_rectangle(cr, 0, 0, width, height);
+    cairo_clip(cr);
+    gdk_cairo_set_source_rgba(cr, &STYLE.backgroundColor);
+    cairo_paint(cr);
+    renderer.drawBorders(cr, GEOMETRY);
+
+    if (GEOMETRY.majorInterval > 0)
+    {
+        TickLayout layout{renderer.getTickPolicy().subdivision};
+        layout.computeVisible(lower, upper, DRAW_AREA_SIZE, GEOMETRY.majorInterval, GEOMETRY.majorTickSpacing,
+                              GEOMETRY.majorTickLength(), 0, DRAW_AREA_SIZE);
+        const std::vector<double> &positions = layout.getPositions();
+        const std::vector<double> &lengths = layout.getLengths();
+        const std::vector<int> &levels = layout.getLevels();
+
+        gdk_cairo_set_source_rgba(cr, &STYLE.lineColor);
+        cairo_set_line_width(cr, RulerRenderer::LINE_WIDTH);
+        for (int level = 0; level < layout.getLevelCount(); level++)
+        {
+            bool hasLines = false;
+            for (size_t i = 0; i < layout.getTickCount(); i++)
+            {
+                if (levels[i] != level || positions[i] <= 0 || positions[i] >= DRAW_AREA_SIZE) { continue; }
+
+                if (HORIZONTAL)
+                {
+                    cairo_move_to(cr, positions[i] + OFFSET, height);
+                    cairo_line_to(cr, positions[i] + OFFSET, height - round(lengths[i]));
+                }
+                else
+                {
+                    cairo_move_to(cr, width, positions[i] + OFFSET);
+                    cairo_line_to(cr, width - round(lengths[i]), positions[i] + OFFSET);
+                }
+                hasLines = true;
+            }
+            if (hasLines) { cairo_stroke(cr); }
+        }
+
+        LabelCache &labelCache = renderer.labelCacheFor(cr);
+        const LabelCache::Metrics &metrics = labelCache.getMetrics();
+        RulerCalculations::LabelBuffer buffer{};
+        for (size_t i = 0; i < layout.getTickCount(); i++)
+        {
+            if (layout.getLabelIndices()[i] == TickLayout::NO_LABEL) { continue; }
+
+            const char *label = RulerCalculations::formatLabel(layout.getLabelValues()[layout.getLabelIndices()[i]], buffer, GEOMETRY.labelDecimals);
+            if (positions[i] + metrics.estimateAdvance(label) <= 0 || positions[i] >= DRAW_AREA_SIZE) { continue; }
+
+            const double ACROSS = RulerRenderer::LABEL_ALIGN * lengths[i] + RulerRenderer::LINE_MULTIPLIER * metrics.digitTop;
+            if (HORIZONTAL)
+            {
+                labelCache.drawLabel(cr, label, positions[i] + RulerRenderer::LABEL_OFFSET, height - ACROSS, false);
+            }
+            else
+            {
+                labelCache.drawLabel(cr, label, width - ACROSS, positions[i] - RulerRenderer::LABEL_OFFSET, true);
+            }
+        }
+    }
+    cairo_restore(cr);
+
+    if (markerPosition + RulerRenderer::MARKER_HALF_WIDTH >= 0 && markerPosition - RulerRenderer::MARKER_HALF_WIDTH <= DRAW_AREA_SIZE)
+    {
+        const double ALONG = markerPosition + OFFSET;
+        if (HORIZONTAL)
+        {
+            const double BASE = height - round(RulerRenderer::MARKER_LENGTH * height);
+            cairo_move_to(cr, ALONG, height);
+            cairo_line_to(cr, ALONG - RulerRenderer::MARKER_HALF_WIDTH, BASE);
+            cairo_line_to(cr, ALONG + RulerRenderer::MARKER_HALF_WIDTH, BASE);
+        }
+        else
+        {
+            const double BASE = width - round(RulerRenderer::MARKER_LENGTH * width);
+            cairo_move_to(cr, width, ALONG);
+            cairo_line_to(cr, BASE, ALONG - RulerRenderer::MARKER_HALF_WIDTH);
+            cairo_line_to(cr, BASE, ALONG + RulerRenderer::MARKER_HALF_WIDTH);
+        }
+        cairo_close_path(cr);
+        gdk_cairo_set_source_rgba(cr, &STYLE.lineColor);
+        cairo_fill(cr);
+    }
+    cairo_destroy(cr);
+    cairo_surface_flush(surface);
+}
+
+BOOST_AUTO_TEST_SUITE(RulerRenderer_Tests)
+
+///////////////
+// Testing the headless renderer
+
+BOOST_AUTO_TEST_CASE(RulerRenderer_render_surface_matches_context,
+    * utf::description("Tests that rendering to a surface is the same as rendering to a context of that surface"))
+{
+    RulerRenderer renderer;
+    cairo_surface_t *fromSurface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+    cairo_surface_t *fromContext = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+
+    renderer.render(fromSurface, RulerRenderer::HORIZONTAL, -123, 877, 1000, 30);
+    cairo_t *cr = cairo_create(fromContext);
+    renderer.render(cr, RulerRenderer::HORIZONTAL, -123, 877, 1000, 30);
+    cairo_destroy(cr);
+    cairo_surface_flush(fromContext);
+
+    BOOST_CHECK(imagesEqual(fromSurface, fromContext));
+
+    cairo_surface_destroy(fromSurface);
+    cairo_surface_destroy(fromContext);
+}
+
+BOOST_AUTO_TEST_CASE(RulerRenderer_render_style,
+    * utf::description("Tests that a ruler is drawn with the colours of its style"))
+{
+    RulerRenderer::Style style;
+    style.lineColor = GdkRGBA{1, 0, 0, 1};
+    style.backgroundColor = GdkRGBA{0, 0, 1, 1};
+    RulerRenderer renderer{style};
+    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+    renderer.render(image, RulerRenderer::HORIZONTAL, 0, 100, 1000, 30);
+
+    // Count the pixels that are fully red or fully blue. ARGB32 is stored in native-endian 32-bit words
+    const int stride = cairo_image_surface_get_stride(image);
+    int lines = 0;
+    int background = 0;
+    for (int y = 0; y < 30; y++)
+    {
+        const auto *row = reinterpret_cast<const uint32_t *>(cairo_image_surface_get_data(image) + y * stride); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        for (int x = 0; x < 1000; x++)
+        {
+            if (row[x] == 0xffff0000) { lines++; }
+            if (row[x] == 0xff0000ff) { background++; }
+        }
+    }
+    // The bottom border alone covers two rows
+    BOOST_CHECK_GE(lines, 2 * 1000);
+    BOOST_CHECK_GT(background, 1000 * 30 / 2);
+
+    cairo_surface_destroy(image);
+}
+
+BOOST_AUTO_TEST_CASE(RulerRenderer_render_offset,
+    * utf::description("Tests that a ruler drawn at an offset in a larger surface is the same as one drawn on its own"))
+{
+    RulerRenderer renderer;
+    cairo_surface_t *alone = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 30, 600);
+    renderer.render(alone, RulerRenderer::VERTICAL, -3.5, 12.5, 30, 600);
+
+    // Two rulers side by side, the second one should be the same as the one drawn alone
+    cairo_surface_t *strip = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 60, 600);
+    cairo_t *cr = cairo_create(strip);
+    renderer.render(cr, RulerRenderer::VERTICAL, 0, 1, 30, 600);
+    cairo_translate(cr, 30, 0);
+    renderer.render(cr, RulerRenderer::VERTICAL, -3.5, 12.5, 30, 600);
+    cairo_destroy(cr);
+
+    cairo_surface_t *second = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 30, 600);
+    cr = cairo_create(second);
+    cairo_set_source_surface(cr, strip, -30, 0);
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    cairo_surface_flush(second);
+
+    BOOST_CHECK(imagesEqual(alone, second));
+
+    cairo_surface_destroy(alone);
+    cairo_surface_destroy(strip);
+    cairo_surface_destroy(second);
+}
+
+BOOST_AUTO_TEST_CASE(RulerRenderer_orientations_match_per_tick_branches,
+    * utf::description("Tests that rulers and markers of both orientations are drawn the same as with a branch on the orientation per tick"))
+{
+    const std::vector<double> MARKERS{-10, 0, 37.25, 150};
+    const std::vector<RulerRenderer::Tile> tiles = createTiles();
+    RulerRenderer renderer;
+    for (const RulerRenderer::Tile &tile : tiles)
+    {
+        for (double marker : MARKERS)
+        {
+            renderer.render(tile.surface, tile.orientation, tile.lower, tile.upper, tile.width, tile.height);
+            cairo_t *cr = cairo_create(tile.surface);
+            renderer.drawMarker(cr, renderer.geometry(tile.orientation, tile.lower, tile.upper, tile.width, tile.height), marker);
+            cairo_destroy(cr);
+            cairo_surface_flush(tile.surface);
+
+            cairo_surface_t *expected = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, tile.width, tile.height);
+            renderPerTickBranches(renderer, expected, tile.orientation, tile.lower, tile.upper, tile.width, tile.height, marker);
+            BOOST_CHECK_MESSAGE(imagesEqual(tile.surface, expected),
+                                (tile.orientation == RulerRenderer::HORIZONTAL ? "horizontal" : "vertical")
+                                    << " ruler [" << tile.lower << ", " << tile.upper << "] of " << tile.width << "x" << tile.height
+                                    << " with marker at " << marker);
+            cairo_surface_destroy(expected);
+        }
+    }
+    destroyTiles(tiles);
+}
+
+///////////////
+// Testing the tick policies
+
+BOOST_AUTO_TEST_CASE(RulerRenderer_render_time_ticks,
+    * utf::description("Tests that a ruler is drawn with the intervals of the tick policy it is given, set up front or later"))
+{
+    RulerRenderer decimal;
+    RulerRenderer time{RulerRenderer::Style{}, RulerRenderer::TickPolicy::of<TimeTicks>()};
+
+    // An hour on 1000px is split into 5 minutes by the time policy, but into 500 seconds by the decimal one
+    BOOST_CHECK_EQUAL(time.geometry(RulerRenderer::HORIZONTAL, 0, 3600, 1000, 30).majorInterval, 300);
+    BOOST_CHECK_EQUAL(decimal.geometry(RulerRenderer::HORIZONTAL, 0, 3600, 1000, 30).majorInterval, 500);
+
+    cairo_surface_t *decimalImage = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+    cairo_surface_t *timeImage = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+    decimal.render(decimalImage, RulerRenderer::HORIZONTAL, 0, 3600, 1000, 30);
+    time.render(timeImage, RulerRenderer::HORIZONTAL, 0, 3600, 1000, 30);
+    BOOST_CHECK(!imagesEqual(timeImage, decimalImage));
+
+    // Setting the policy on a renderer that has drawn before is the same as creating one with it
+    RulerRenderer renderer;
+    renderer.render(image, RulerRenderer::HORIZONTAL, 0, 3600, 1000, 30);
+    renderer.setTickPolicy(RulerRenderer::TickPolicy::of<TimeTicks>());
+    renderer.render(image, RulerRenderer::HORIZONTAL, 0, 3600, 1000, 30);
+    BOOST_CHECK(imagesEqual(image, timeImage));
+
+    renderer.setTickPolicy(RulerRenderer::TickPolicy::of<DecimalTicks>());
+    renderer.render(image, RulerRenderer::HORIZONTAL, 0, 3600, 1000, 30);
+    BOOST_CHECK(imagesEqual(image, decimalImage));
+
+    cairo_surface_destroy(decimalImage);
+    cairo_surface_destroy(timeImage);
+    cairo_surface_destroy(image);
+}
+
+BOOST_AUTO_TEST_CASE(RulerRenderer_render_binary_ticks,
+    * utf::description("Tests that a vertical ruler with binary ticks puts its major ticks at powers of 2"))
+{
+    RulerRenderer renderer{RulerRenderer::Style{}, RulerRenderer::TickPolicy::of<BinaryTicks>()};
+    const RulerRenderer::Geometry GEOMETRY = renderer.geometry(RulerRenderer::VERTICAL, 0, 1000, 30, 1000);
+    BOOST_CHECK_EQUAL(GEOMETRY.majorInterval, 128);
+
+    // Every tick is halfway between the ticks one level up
+    TickLayout layout{renderer.getTickPolicy().subdivision};
+    layout.compute(0, 1000, 1000, GEOMETRY.majorInterval, GEOMETRY.majorTickSpacing, GEOMETRY.majorTickLength());
+    BOOST_REQUIRE_GT(layout.getTickCount(), 2);
+    BOOST_CHECK_EQUAL(layout.getPositions()[1] - layout.getPositions()[0], 8);
+
+    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 30, 1000);
+    renderer.render(image, RulerRenderer::VERTICAL, 0, 1000, 30, 1000);
+    cairo_surface_t *decimalImage = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 30, 1000);
+    RulerRenderer{}.render(decimalImage, RulerRenderer::VERTICAL, 0, 1000, 30, 1000);
+    BOOST_CHECK(!imagesEqual(image, decimalImage));
+
+    cairo_surface_destroy(image);
+    cairo_surface_destroy(decimalImage);
+}
+
+///////////////
+// Testing batch rendering
+
+BOOST_AUTO_TEST_CASE(RulerRenderPool_matches_sequential_render,
+    * utf::description("Tests that rendering a batch of tiles in parallel is the same as rendering them one at a time"))
+{
+    RulerRenderPool pool{RulerRenderer::Style{}, 4};
+    BOOST_CHECK_EQUAL(pool.getThreadCount(), 4);
+
+    std::vector<RulerRenderer::Tile> tiles = createTiles();
+    pool.render(tiles);
+    BOOST_CHECK(tilesMatchSequentialRender(tiles));
+    destroyTiles(tiles);
+}
+
+BOOST_AUTO_TEST_CASE(RulerRenderPool_several_batches,
+    * utf::description("Tests that a pool renders every batch it is given, with the caches of its workers warm from the batches before"))
+{
+    RulerRenderPool pool{RulerRenderer::Style{}, 3};
+    for (int batch = 0; batch < 3; batch++)
+    {
+        std::vector<RulerRenderer::Tile> tiles = createTiles();
+        pool.render(tiles);
+        BOOST_CHECK(tilesMatchSequentialRender(tiles));
+        destroyTiles(tiles);
+    }
+
+    // An empty batch returns immediately
+    pool.render({});
+}
+
+BOOST_AUTO_TEST_CASE(RulerRenderPool_default_thread_count,
+    * utf::description("Tests that a pool has at least one worker thread by default"))
+{
+    RulerRenderPool pool;
+    BOOST_CHECK_GE(pool.getThreadCount(), 1);
+}
+
+///////////////
+// Testing the space for labels
+
+BOOST_AUTO_TEST_CASE(RulerRenderer_labels_fit_interval,
+    * utf::description("Tests that the label of every major tick fits between its tick and the next, also at large coordinates"))
+{
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+    cairo_t *cr = cairo_create(surface);
+    const RulerRenderer::Style STYLE;
+    cairo_select_font_face(cr, STYLE.fontFamily.c_str(), CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, STYLE.fontSize);
+
+    RulerRenderer renderer;
+    TickLayout layout{RulerRenderer::TickPolicy::of<RulerRenderer::DefaultTicks>().subdivision};
+    RulerCalculations::LabelBuffer label{};
+    for (double lower : {0.0, -123.0, 1e9, -1e12, 1e15})
+    {
+        for (double range : {10.0, 1000.0, 1e6})
+        {
+            for (int length : {200, 1000})
+            {
+                const RulerRenderer::Geometry GEOMETRY = renderer.geometry(RulerRenderer::HORIZONTAL, lower, lower + range, length, 30);
+                layout.compute(lower, lower + range, length, GEOMETRY.majorInterval, GEOMETRY.majorTickSpacing, GEOMETRY.majorTickLength());
+                for (double value : layout.getLabelValues())
+                {
+                    cairo_text_extents_t extents;
+                    cairo_text_extents(cr, RulerCalculations::formatLabel(value, label), &extents);
+                    BOOST_CHECK_MESSAGE(extents.x_advance < GEOMETRY.majorTickSpacing,
+                                        "label " << label.data() << " of range [" << lower << ", " << lower + range << "] at "
+                                                 << length << "px is " << extents.x_advance << "px, spacing "
+                                                 << GEOMETRY.majorTickSpacing << "px");
+                }
+            }
+        }
+    }
+
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,145 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+namespace utf = boost::unit_test;
+
+#include "../src/sharedtickcache.hh"
+
+/**
+ * Returns the key of a horizontal ruler in the default style.
+ * @param lower Lower limit of the ruler range.
+ * @param upper Upper limit of the ruler range.
+ * @return The key of the ruler.
+ */
+static SharedTickCache::Key rulerKey(double lower, double upper)
+{
+    const RulerRenderer::Style STYLE;
+    return SharedTickCache::Key{lower, upper, 1000, 30, RulerRenderer::HORIZONTAL, 1, STYLE.fontFamily, STYLE.fontSize, STYLE.lineColor};
+}
+
+/**
+ * Returns the number of bytes the cache counts for a surface of a ruler of rulerKey().
+ * @return The size of the surface in bytes.
+ */
+static size_t rulerBytes()
+{
+    return static_cast<size_t>(cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, 1000)) * 30;
+}
+
+BOOST_AUTO_TEST_SUITE(SharedTickCache_Tests)
+
+///////////////
+// Testing lookups
+
+BOOST_AUTO_TEST_CASE(SharedTickCache_lookup_inserted,
+    * utf::description("Tests that a surface that was inserted is found for an identical key only"))
+{
+    SharedTickCache cache;
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+    BOOST_CHECK(cache.lookup(rulerKey(0, 100)) == nullptr);
+    BOOST_CHECK(cache.insert(rulerKey(0, 100), surface));
+
+    cairo_surface_t *found = cache.lookup(rulerKey(0, 100));
+    BOOST_CHECK(found == surface);
+    cairo_surface_destroy(found);
+
+    SharedTickCache::Key otherColor = rulerKey(0, 100);
+    otherColor.lineColor = GdkRGBA{1, 0, 0, 1};
+    BOOST_CHECK(cache.lookup(otherColor) == nullptr);
+    SharedTickCache::Key otherScale = rulerKey(0, 100);
+    otherScale.scaleFactor = 2;
+    BOOST_CHECK(cache.lookup(otherScale) == nullptr);
+    BOOST_CHECK(cache.lookup(rulerKey(0, 101)) == nullptr);
+
+    const SharedTickCache::Usage USAGE = cache.getUsage();
+    BOOST_CHECK_EQUAL(USAGE.entries, 1);
+    BOOST_CHECK_EQUAL(USAGE.bytes, rulerBytes());
+    BOOST_CHECK_EQUAL(USAGE.hits, 1);
+    BOOST_CHECK_EQUAL(USAGE.misses, 4);
+
+    // The cache holds a reference of its own
+    cairo_surface_destroy(surface);
+    found = cache.lookup(rulerKey(0, 100));
+    BOOST_CHECK(found != nullptr);
+    BOOST_CHECK_EQUAL(cairo_image_surface_get_width(found), 1000);
+    cairo_surface_destroy(found);
+}
+
+BOOST_AUTO_TEST_CASE(SharedTickCache_insert_existing,
+    * utf::description("Tests that a surface isn't inserted for a key that is already in the cache"))
+{
+    SharedTickCache cache;
+    cairo_surface_t *first = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+    cairo_surface_t *second = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+    BOOST_CHECK(cache.insert(rulerKey(0, 100), first));
+    BOOST_CHECK(!cache.insert(rulerKey(0, 100), second));
+
+    cairo_surface_t *found = cache.lookup(rulerKey(0, 100));
+    BOOST_CHECK(found == first);
+    BOOST_CHECK_EQUAL(cache.getUsage().entries, 1);
+
+    cairo_surface_destroy(found);
+    cairo_surface_destroy(first);
+    cairo_surface_destroy(second);
+}
+
+///////////////
+// Testing the memory limit
+
+BOOST_AUTO_TEST_CASE(SharedTickCache_evicts_least_recently_used,
+    * utf::description("Tests that the least recently used surface is released when the cache grows beyond its memory limit"))
+{
+    SharedTickCache cache;
+    cache.setMemoryLimit(2 * rulerBytes());
+    for (double lower : {0.0, 1.0})
+    {
+        cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+        cache.insert(rulerKey(lower, lower + 100), surface);
+        cairo_surface_destroy(surface);
+    }
+
+    // Using the first ruler makes the second one the least recently used
+    cairo_surface_destroy(cache.lookup(rulerKey(0, 100)));
+    cairo_surface_t *third = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+    BOOST_CHECK(cache.insert(rulerKey(2, 102), third));
+    cairo_surface_destroy(third);
+
+    cairo_surface_t *found = cache.lookup(rulerKey(0, 100));
+    BOOST_CHECK(found != nullptr);
+    if (found != nullptr) { cairo_surface_destroy(found); }
+    BOOST_CHECK(cache.lookup(rulerKey(1, 101)) == nullptr);
+
+    const SharedTickCache::Usage USAGE = cache.getUsage();
+    BOOST_CHECK_EQUAL(USAGE.entries, 2);
+    BOOST_CHECK_EQUAL(USAGE.bytes, 2 * rulerBytes());
+    BOOST_CHECK_EQUAL(USAGE.memoryLimit, 2 * rulerBytes());
+    BOOST_CHECK_EQUAL(USAGE.evictions, 1);
+}
+
+BOOST_AUTO_TEST_CASE(SharedTickCache_limit,
+    * utf::description("Tests that lowering the memory limit releases surfaces, and that a surface larger than the limit isn't inserted"))
+{
+    SharedTickCache cache;
+    for (double lower : {0.0, 1.0, 2.0})
+    {
+        cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+        cache.insert(rulerKey(lower, lower + 100), surface);
+        cairo_surface_destroy(surface);
+    }
+    BOOST_CHECK_EQUAL(cache.getUsage().entries, 3);
+
+    cache.setMemoryLimit(rulerBytes());
+    BOOST_CHECK_EQUAL(cache.getUsage().entries, 1);
+    BOOST_CHECK_EQUAL(cache.getUsage().evictions, 2);
+
+    cache.setMemoryLimit(rulerBytes() - 1);
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1000, 30);
+    BOOST_CHECK(!cache.insert(rulerKey(3, 103), surface));
+    cairo_surface_destroy(surface);
+    BOOST_CHECK_EQUAL(cache.getUsage().entries, 0);
+    BOOST_CHECK_EQUAL(cache.getUsage().bytes, 0);
+
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.getUsage().evictions, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
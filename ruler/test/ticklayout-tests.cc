@@ -0,0 +1,260 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+namespace utf = boost::unit_test;
+
+#include "../src/ticklayout.hh"
+
+#include <algorithm>
+
+BOOST_AUTO_TEST_SUITE(TickLayout_Tests)
+
+///////////////
+// Testing the ticks in the layout
+
+BOOST_AUTO_TEST_CASE(TickLayout_range_0_to_1000_size_1000px_interval_100,
+    * utf::description("Tests that range [0, 1000] with interval 100 on a ruler of 1000px has 10 major ticks with 9 sub-ticks each"))
+{
+    TickLayout layout;
+    layout.compute(0, 1000, 1000, 100, 100, 24);
+
+    BOOST_CHECK(layout.getLevelCount() == 3);
+    BOOST_CHECK(layout.getTickCount() == 100);
+    BOOST_CHECK(layout.getLabelValues().size() == 10);
+    BOOST_CHECK(layout.getLabelValues().front() == 0);
+    BOOST_CHECK(layout.getLabelValues().back() == 900);
+}
+
+BOOST_AUTO_TEST_CASE(TickLayout_levels_between_major_ticks,
+    * utf::description("Tests that the ticks between two major ticks alternate between the two sub-tick levels"))
+{
+    TickLayout layout;
+    layout.compute(0, 1000, 1000, 100, 100, 24);
+
+    const std::vector<double> expectedPositions{100, 110, 120, 130, 140, 150, 160, 170, 180, 190, 200};
+    const std::vector<int> expectedLevels{0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 0};
+    // The major tick at 100 is the 11th tick in the layout
+    const size_t FIRST = 10;
+    for (size_t i = 0; i < expectedPositions.size(); i++)
+    {
+        BOOST_CHECK(layout.getPositions().at(FIRST + i) == expectedPositions.at(i));
+        BOOST_CHECK(layout.getLevels().at(FIRST + i) == expectedLevels.at(i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TickLayout_line_lengths,
+    * utf::description("Tests that every level down has lines 0.6 times as long as the level above"))
+{
+    TickLayout layout;
+    layout.compute(0, 1000, 1000, 100, 100, 25);
+
+    BOOST_CHECK_CLOSE(layout.getLengths().at(10), 25, 1e-9);
+    BOOST_CHECK_CLOSE(layout.getLengths().at(12), 15, 1e-9);
+    BOOST_CHECK_CLOSE(layout.getLengths().at(11), 9, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(TickLayout_labels_only_on_major_ticks,
+    * utf::description("Tests that only the major ticks have a label"))
+{
+    TickLayout layout;
+    layout.compute(0, 1000, 1000, 100, 100, 24);
+
+    for (size_t i = 0; i < layout.getTickCount(); i++)
+    {
+        const bool IS_MAJOR = layout.getLevels().at(i) == 0;
+        BOOST_CHECK((layout.getLabelIndices().at(i) != TickLayout::NO_LABEL) == IS_MAJOR);
+    }
+}
+
+///////////////
+// Testing the number of sub-tick levels
+
+BOOST_AUTO_TEST_CASE(TickLayout_spacing_40px_one_subtick_level,
+    * utf::description("Tests that a major tick spacing of 40px only fits one level of sub-ticks"))
+{
+    TickLayout layout;
+    layout.compute(0, 1000, 400, 100, 40, 24);
+
+    BOOST_CHECK(layout.getLevelCount() == 2);
+    BOOST_CHECK(layout.getTickCount() == 50);
+}
+
+BOOST_AUTO_TEST_CASE(TickLayout_spacing_20px_no_subticks,
+    * utf::description("Tests that a major tick spacing of 20px doesn't fit any sub-ticks"))
+{
+    TickLayout layout;
+    layout.compute(0, 1000, 200, 100, 20, 24);
+
+    BOOST_CHECK(layout.getLevelCount() == 1);
+    BOOST_CHECK(layout.getTickCount() == 10);
+}
+
+///////////////
+// Testing ticks outside the drawing area
+
+BOOST_AUTO_TEST_CASE(TickLayout_range_neg123_to_278_first_major_tick_outside,
+    * utf::description("Tests that the major tick before the range is laid out, but its sub-ticks outside the ruler are not"))
+{
+    TickLayout layout;
+    layout.compute(-123, 278, 401, 50, 50, 24);
+
+    BOOST_CHECK(layout.getLabelValues().front() == -150);
+    BOOST_CHECK(layout.getPositions().front() == -27);
+    // Only the major ticks are allowed outside the drawing area
+    for (size_t i = 0; i < layout.getTickCount(); i++)
+    {
+        if (layout.getLevels().at(i) == 0) { continue; }
+        BOOST_CHECK(layout.getPositions().at(i) > 0);
+        BOOST_CHECK(layout.getPositions().at(i) < 401);
+    }
+    BOOST_CHECK(std::is_sorted(layout.getPositions().begin(), layout.getPositions().end()));
+}
+
+BOOST_AUTO_TEST_CASE(TickLayout_grouped_by_level,
+    * utf::description("Tests that the ticks grouped by level contain every tick once, at its own level and ordered by position"))
+{
+    TickLayout layout;
+    layout.compute(-123, 278, 401, 50, 50, 24);
+
+    const std::vector<size_t> &order = layout.getLevelOrder();
+    const std::vector<size_t> &starts = layout.getLevelStarts();
+    BOOST_CHECK(starts.size() == static_cast<size_t>(layout.getLevelCount()) + 1);
+    BOOST_CHECK(starts.front() == 0);
+    BOOST_CHECK(starts.back() == layout.getTickCount());
+    BOOST_CHECK(order.size() == layout.getTickCount());
+
+    std::vector<bool> seen(layout.getTickCount(), false);
+    for (int level = 0; level < layout.getLevelCount(); level++)
+    {
+        for (size_t k = starts.at(level); k < starts.at(level + 1); k++)
+        {
+            BOOST_CHECK(layout.getLevels().at(order.at(k)) == level);
+            if (k > starts.at(level)) { BOOST_CHECK(order.at(k - 1) < order.at(k)); }
+            seen.at(order.at(k)) = true;
+        }
+    }
+    BOOST_CHECK(std::all_of(seen.begin(), seen.end(), [](bool s) { return s; }));
+    // The major ticks come first
+    BOOST_CHECK(starts.at(1) == layout.getLabelValues().size());
+}
+
+BOOST_AUTO_TEST_CASE(TickLayout_part_of_range,
+    * utf::description("Tests that laying out [300, 500) of range [0, 1000] only gives the major ticks 300 and 400"))
+{
+    TickLayout layout;
+    layout.compute(0, 1000, 1000, 100, 100, 24, 300, 500);
+
+    BOOST_CHECK(layout.getLabelValues() == std::vector<double>({300, 400}));
+    BOOST_CHECK(layout.getTickCount() == 20);
+}
+
+///////////////
+// Testing the visible window
+
+BOOST_AUTO_TEST_CASE(TickLayout_visible_full_window_matches_full_range,
+    * utf::description("Tests that laying out the visible ticks of the whole ruler gives the same ticks as laying out the full range"))
+{
+    TickLayout full;
+    full.compute(-123, 278, 401, 50, 50, 24);
+    TickLayout visible;
+    visible.computeVisible(-123, 278, 401, 50, 50, 24, 0, 401);
+
+    BOOST_CHECK(visible.getPositions() == full.getPositions());
+    BOOST_CHECK(visible.getLevels() == full.getLevels());
+    BOOST_CHECK(visible.getLabelValues() == full.getLabelValues());
+}
+
+BOOST_AUTO_TEST_CASE(TickLayout_visible_narrow_window,
+    * utf::description("Tests that a window of a few pixels only has the sub-ticks within it, and the major ticks whose labels may reach it"))
+{
+    TickLayout layout;
+    layout.computeVisible(0, 1000, 1000, 100, 100, 24, 305, 312);
+
+    BOOST_CHECK(layout.getLabelValues() == std::vector<double>({200, 300, 400}));
+    BOOST_CHECK(layout.getPositions() == std::vector<double>({200, 300, 310, 400}));
+}
+
+BOOST_AUTO_TEST_CASE(TickLayout_visible_line_touching_window,
+    * utf::description("Tests that a sub-tick whose line covers the first pixel of the window is laid out"))
+{
+    TickLayout layout;
+    layout.computeVisible(0, 1000, 1000, 100, 100, 24, 311, 319);
+
+    // The line at 310 covers pixel 310 only, the line at 320 starts after the window
+    BOOST_CHECK(layout.getPositions() == std::vector<double>({200, 300, 400}));
+
+    layout.computeVisible(0, 1000, 1000, 100, 100, 24, 310, 321);
+    BOOST_CHECK(layout.getPositions() == std::vector<double>({200, 300, 310, 320, 400}));
+}
+
+BOOST_AUTO_TEST_CASE(TickLayout_visible_window_count_independent_of_size,
+    * utf::description("Tests that the number of ticks in a window doesn't depend on the size of the ruler"))
+{
+    TickLayout layout;
+    layout.computeVisible(0, 1e6, 1e6, 100, 100, 24, 500000, 500011);
+
+    // The major ticks 499900, 500000 and 500100, and the sub-tick 500010
+    BOOST_CHECK(layout.getTickCount() == 4);
+}
+
+///////////////
+// Testing the subdivisions of tick policies
+
+BOOST_AUTO_TEST_CASE(TickLayout_policy_table_matches_calculated_levels,
+    * utf::description("Tests that the compile-time table of decimal ticks gives the same layout as calculating the levels"))
+{
+    TickLayout calculated;
+    TickLayout tabulated{TickLayout::Subdivision::of<DecimalTicks>(5, 0.6)};
+    for (int spacing : {20, 40, 100})
+    {
+        calculated.compute(-123, 278, 401, 50, spacing, 24);
+        tabulated.compute(-123, 278, 401, 50, spacing, 24);
+        BOOST_CHECK(tabulated.getLevelCount() == calculated.getLevelCount());
+        BOOST_CHECK(tabulated.getPositions() == calculated.getPositions());
+        BOOST_CHECK(tabulated.getLevels() == calculated.getLevels());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TickLayout_policy_binary_halves,
+    * utf::description("Tests that binary ticks with a spacing of 128px are halved four times"))
+{
+    TickLayout layout{TickLayout::Subdivision::of<BinaryTicks>(5, 0.6)};
+    layout.compute(0, 1024, 1024, 128, 128, 24);
+
+    BOOST_CHECK(layout.getLevelCount() == 5);
+    BOOST_CHECK(layout.getTickCount() == 8 * 16);
+    const std::vector<int> expectedLevels{0, 4, 3, 4, 2, 4, 3, 4, 1, 4, 3, 4, 2, 4, 3, 4, 0};
+    BOOST_CHECK(std::vector<int>(layout.getLevels().begin(), layout.getLevels().begin() + 17) == expectedLevels);
+}
+
+BOOST_AUTO_TEST_CASE(TickLayout_policy_time_levels,
+    * utf::description("Tests that time ticks split a major tick into halves and then thirds"))
+{
+    const auto &LEVELS = TickTables<TimeTicks>::SUBTICK_LEVELS;
+    const size_t ROW = 2 * TickTables<TimeTicks>::MAX_SEGMENTS;
+    BOOST_CHECK(std::vector<int>(LEVELS.begin() + ROW, LEVELS.begin() + ROW + 6) == std::vector<int>({0, 2, 2, 1, 2, 2}));
+}
+
+///////////////
+// Testing invalid input
+
+BOOST_AUTO_TEST_CASE(TickLayout_invalid_interval,
+    * utf::description("Tests that an invalid interval gives an empty layout"))
+{
+    TickLayout layout;
+    layout.compute(0, 1000, 1000, -1, 100, 24);
+
+    BOOST_CHECK(layout.getTickCount() == 0);
+    BOOST_CHECK(layout.getLevelOrder().empty());
+    BOOST_CHECK(layout.getLevelStarts() == std::vector<size_t>({0}));
+}
+
+BOOST_AUTO_TEST_CASE(TickLayout_invalid_range,
+    * utf::description("Tests that an invalid range gives an empty layout"))
+{
+    TickLayout layout;
+    layout.compute(10, 0, 1000, 1, 100, 24);
+
+    BOOST_CHECK(layout.getTickCount() == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,149 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+namespace utf = boost::unit_test;
+
+#include "../src/tickprefetcher.hh"
+
+#include <cstring>
+
+/**
+ * Returns the key of a layout, with the interval and spacing calculated for the range and size.
+ * @param lower Lower limit of the ruler range.
+ * @param upper Upper limit of the ruler range.
+ * @param drawAreaSize The width/height in pixels of the ruler.
+ * @return The key of the layout.
+ */
+static TickPrefetcher::Key layoutKey(double lower, double upper, double drawAreaSize)
+{
+    const double INTERVAL = RulerCalculations::calculateInterval(lower, upper, drawAreaSize);
+    const int SPACING = RulerCalculations::intervalPixelSpacing(INTERVAL, lower, upper, drawAreaSize);
+    return TickPrefetcher::Key{lower, upper, drawAreaSize, INTERVAL, SPACING, 24, 1};
+}
+
+/**
+ * Creates a prefetcher with the default subdivision and font of a ruler.
+ * @param memoryBudget The maximum memory used by the published layouts in bytes.
+ * @return The newly created prefetcher.
+ */
+static std::unique_ptr<TickPrefetcher> createPrefetcher(size_t memoryBudget = TickPrefetcher::DEFAULT_MEMORY_BUDGET)
+{
+    return std::make_unique<TickPrefetcher>(TickLayout::Subdivision{}, "sans-serif", 11, memoryBudget);
+}
+
+BOOST_AUTO_TEST_SUITE(TickPrefetcher_Tests)
+
+///////////////
+// Testing the published layouts
+
+BOOST_AUTO_TEST_CASE(TickPrefetcher_take_matches_direct_computation,
+    * utf::description("Tests that a precomputed layout and its label extents are the same as those computed on the main thread"))
+{
+    auto prefetcher = createPrefetcher();
+    const TickPrefetcher::Key ZOOMED_IN = layoutKey(0, 500, 1000);
+    const TickPrefetcher::Key ZOOMED_OUT = layoutKey(-500, 1500, 1000);
+    prefetcher->request({ZOOMED_IN, ZOOMED_OUT});
+    prefetcher->wait();
+
+    std::unique_ptr<TickPrefetcher::Result> result = prefetcher->take(ZOOMED_OUT.majorInterval);
+    BOOST_REQUIRE(result != nullptr);
+    BOOST_CHECK(result->key == ZOOMED_OUT);
+
+    TickLayout direct;
+    direct.compute(-500, 1500, 1000, ZOOMED_OUT.majorInterval, ZOOMED_OUT.majorTickSpacing, 24);
+    BOOST_CHECK(result->layout.getPositions() == direct.getPositions());
+    BOOST_CHECK(result->layout.getLevels() == direct.getLevels());
+    BOOST_CHECK(result->layout.getLabelValues() == direct.getLabelValues());
+
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+    cairo_t *cr = cairo_create(surface);
+    cairo_select_font_face(cr, "sans-serif", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, 11);
+    BOOST_REQUIRE(result->labels.size() == direct.getLabelValues().size());
+    BOOST_REQUIRE(result->labelExtents.size() == direct.getLabelValues().size());
+    for (size_t i = 0; i < result->labels.size(); i++)
+    {
+        RulerCalculations::LabelBuffer label{};
+        BOOST_CHECK(strcmp(result->labels[i].data(), RulerCalculations::formatLabel(direct.getLabelValues()[i], label)) == 0);
+        cairo_text_extents_t extents;
+        cairo_text_extents(cr, label.data(), &extents);
+        BOOST_CHECK(result->labelExtents[i].x_advance == extents.x_advance);
+        BOOST_CHECK(result->labelExtents[i].width == extents.width);
+        BOOST_CHECK(result->labelExtents[i].y_bearing == extents.y_bearing);
+    }
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+
+    // Taking a layout releases the other one
+    BOOST_CHECK(prefetcher->take(ZOOMED_IN.majorInterval) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(TickPrefetcher_take_other_interval,
+    * utf::description("Tests that no layout is taken for an interval that wasn't predicted, and that this counts as a miss"))
+{
+    auto prefetcher = createPrefetcher();
+    const TickPrefetcher::Key ZOOMED_IN = layoutKey(0, 500, 1000);
+    prefetcher->request({ZOOMED_IN, layoutKey(-500, 1500, 1000)});
+    prefetcher->wait();
+
+    BOOST_CHECK(prefetcher->take(ZOOMED_IN.majorInterval * 1000) == nullptr);
+    const TickPrefetcher::Stats STATS = prefetcher->getStats();
+    BOOST_CHECK_EQUAL(STATS.requested, 2);
+    BOOST_CHECK_EQUAL(STATS.published, 2);
+    BOOST_CHECK_EQUAL(STATS.dropped, 0);
+#ifdef SCROOMRULER_STATS
+    BOOST_CHECK_EQUAL(STATS.hits, 0);
+    BOOST_CHECK_EQUAL(STATS.misses, 1);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(TickPrefetcher_latest_request,
+    * utf::description("Tests that a new request replaces the layouts of the previous one"))
+{
+    auto prefetcher = createPrefetcher();
+    prefetcher->request({layoutKey(0, 50, 1000), layoutKey(-50, 150, 1000)});
+    const TickPrefetcher::Key ZOOMED_IN = layoutKey(0, 50000, 1000);
+    prefetcher->request({ZOOMED_IN, layoutKey(-50000, 150000, 1000)});
+    prefetcher->wait();
+
+    std::unique_ptr<TickPrefetcher::Result> result = prefetcher->take(ZOOMED_IN.majorInterval);
+    BOOST_REQUIRE(result != nullptr);
+    BOOST_CHECK(result->key == ZOOMED_IN);
+}
+
+///////////////
+// Testing the memory budget
+
+BOOST_AUTO_TEST_CASE(TickPrefetcher_memory_budget,
+    * utf::description("Tests that layouts that don't fit in the memory budget are dropped"))
+{
+    auto prefetcher = createPrefetcher(1);
+    const TickPrefetcher::Key ZOOMED_IN = layoutKey(0, 500, 1000);
+    prefetcher->request({ZOOMED_IN, layoutKey(-500, 1500, 1000)});
+    prefetcher->wait();
+
+    BOOST_CHECK(prefetcher->take(ZOOMED_IN.majorInterval) == nullptr);
+    BOOST_CHECK_EQUAL(prefetcher->getStats().published, 0);
+    BOOST_CHECK_EQUAL(prefetcher->getStats().dropped, 2);
+}
+
+BOOST_AUTO_TEST_CASE(TickPrefetcher_memory_budget_one_layout,
+    * utf::description("Tests that a budget with room for one layout publishes the first one only"))
+{
+    const TickPrefetcher::Key FIRST = layoutKey(0, 500, 1000);
+    const TickPrefetcher::Key SECOND = layoutKey(-500, 1500, 1000);
+
+    // Find the size of the first layout
+    auto unlimited = createPrefetcher();
+    unlimited->request({FIRST, SECOND});
+    unlimited->wait();
+    const size_t FIRST_BYTES = unlimited->take(FIRST.majorInterval)->bytes;
+
+    auto prefetcher = createPrefetcher(FIRST_BYTES);
+    prefetcher->request({FIRST, SECOND});
+    prefetcher->wait();
+    BOOST_CHECK_EQUAL(prefetcher->getStats().published, 1);
+    BOOST_CHECK_EQUAL(prefetcher->getStats().dropped, 1);
+    BOOST_CHECK(prefetcher->take(FIRST.majorInterval) != nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()